@@ -0,0 +1,158 @@
+#!/bin/bash
+#
+# bench.sh: run every echo server model under the load generator and write
+# one row per run to results.csv and results.json
+#
+# every model is built, started on its own loopback port, loaded by
+# ../loadgen for each connection count and message size, and killed. the
+# cpu time (user + system, children included) and the peak rss of the
+# server are read from /proc.
+#
+# the sweep is set by the environment:
+#     MODELS    the models to run, see the table below
+#     CONNS     the connection counts          (10 100 1000 10000)
+#     SIZES     the message sizes in bytes     (16 1024 65536 1048576)
+#     DURATION  the seconds of each run        (5)
+#     THREADS   the loadgen threads            (2)
+#     DEPTH     the messages each connection pipelines (1)
+#     MAXBYTES  skip the runs with more than this many bytes in flight,
+#               conns * size                   (268435456)
+#     PORT      the first port used            (19000)
+#
+# example: CONNS="10 100" SIZES="16 1024" DURATION=2 ./bench.sh
+#
+# processperchild is not in the table: it is an interactive chat that
+# forwards stdin to the client, not an echo server.
+#
+# threadpool and prefork serve at most 8 connections at once, a worker or a
+# child keeps its client until it closes. with more connections the rest
+# are connected but never served during the run, and loadgen counts only
+# the messages of the served ones.
+
+cd "$(dirname "$0")"
+
+# name:directory:server options. the loop-* models run the poll server on
+# the other netcore backends, so the four backends are compared on the
+# same code
+ALL_MODELS="
+select:multioselect:
+poll:multiopoll:
+loop-epoll:multiopoll:-e epoll
+loop-uring:multiopoll:-e uring
+epoll-lt:multioepoll:
+epoll-et:multioepoll2:-t 1
+uring:multiouring:
+fork:processperchild1:
+threadpool:processperchild1:-t 8
+prefork:processperchild1:-f 8
+"
+
+MODELS=${MODELS:-$(echo "$ALL_MODELS" | grep -v '^$' | cut -d: -f1)}
+CONNS=${CONNS:-"10 100 1000 10000"}
+SIZES=${SIZES:-"16 1024 65536 1048576"}
+DURATION=${DURATION:-5}
+THREADS=${THREADS:-2}
+DEPTH=${DEPTH:-1}
+MAXBYTES=${MAXBYTES:-268435456}
+PORT=${PORT:-19000}
+
+CSV=results.csv
+JSON=results.json
+
+# cpu_ticks <pid>: utime + stime + cutime + cstime of the process and the
+# children it has not reaped yet (the preforked ones)
+cpu_ticks()
+{
+    local stats="/proc/$1/stat"
+    for child in $(pgrep -P $1)
+    do
+        stats="$stats /proc/$child/stat"
+    done
+    cat $stats 2>/dev/null | awk '{ t += $14 + $15 + $16 + $17 } END { print t + 0 }'
+}
+
+# peak_rss <pid>: the peak resident set size in kB of the process plus its
+# live children
+peak_rss()
+{
+    local stats="/proc/$1/status"
+    for child in $(pgrep -P $1)
+    do
+        stats="$stats /proc/$child/status"
+    done
+    cat $stats 2>/dev/null | awk '/^VmHWM/ { kb += $2 } END { print kb + 0 }'
+}
+
+make -s -C ../loadgen || exit 1
+
+HZ=$(getconf CLK_TCK)
+echo "model,conns,size,connected,failed,errors,mismatches,msgs_per_s,mb_per_s,p50_us,p99_us,p999_us,max_us,cpu_s,rss_kb" > $CSV
+echo "[" > $JSON
+first=1
+
+for model in $MODELS
+do
+    line=$(echo "$ALL_MODELS" | grep "^$model:")
+    if [ -z "$line" ]
+    then
+        echo "unknown model $model" >&2
+        continue
+    fi
+    dir=$(echo "$line" | cut -d: -f2)
+    opts=$(echo "$line" | cut -d: -f3)
+
+    make -s -C ../$dir server || exit 1
+
+    for conns in $CONNS
+    do
+        for size in $SIZES
+        do
+            if [ $((conns * size)) -gt $MAXBYTES ]
+            then
+                echo "skip $model $conns x $size: more than $MAXBYTES bytes in flight" >&2
+                continue
+            fi
+
+            PORT=$((PORT + 1))
+            ../$dir/server $opts $PORT > /dev/null 2>&1 < /dev/null &
+            pid=$!
+            sleep 0.5
+
+            cpu0=$(cpu_ticks $pid)
+            out=$(../loadgen/loadgen -c $conns -t $THREADS -s $size -p $DEPTH -d $DURATION 127.0.0.1 $PORT 2>/dev/null)
+            cpu1=$(cpu_ticks $pid)
+            rss=$(peak_rss $pid)
+
+            kill $pid 2>/dev/null
+            pkill -P $pid 2>/dev/null
+            wait $pid 2>/dev/null
+
+            # pick the numbers out of the loadgen report
+            row=$(echo "$out" | awk -v m=$model -v c=$conns -v s=$size \
+                  -v cpu=$(awk -v a=$cpu0 -v b=$cpu1 -v hz=$HZ 'BEGIN { printf "%.2f", (b - a) / hz }') \
+                  -v rss=${rss:-0} '
+                /^connected/ { conn = $2; failed = $4; errors = $6; mism = $8 }
+                /^messages/  { mps = $6; mbps = $8 }
+                /^latency/   { p50 = $3; p99 = $5; p999 = $7; max = $9 }
+                END {
+                    printf "%s,%s,%s,%d,%d,%d,%d,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%s,%d\n",
+                           m, c, s, conn, failed, errors, mism, mps, mbps,
+                           p50, p99, p999, max, cpu, rss
+                }')
+            echo "$row" >> $CSV
+            echo "$row"
+
+            [ $first -eq 1 ] || echo "," >> $JSON
+            first=0
+            echo "$row" | awk -F, '{
+                printf "  {\"model\": \"%s\", \"conns\": %s, \"size\": %s, \"connected\": %s, \"failed\": %s, ", $1, $2, $3, $4, $5
+                printf "\"errors\": %s, \"mismatches\": %s, \"msgs_per_s\": %s, \"mb_per_s\": %s, ", $6, $7, $8, $9
+                printf "\"p50_us\": %s, \"p99_us\": %s, \"p999_us\": %s, \"max_us\": %s, ", $10, $11, $12, $13
+                printf "\"cpu_s\": %s, \"rss_kb\": %s}", $14, $15
+            }' >> $JSON
+        done
+    done
+done
+
+echo "" >> $JSON
+echo "]" >> $JSON
@@ -0,0 +1,236 @@
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  <errno.h>
+#include  <time.h>
+
+#include  <fcntl.h>
+#include  <poll.h>
+#include  <unistd.h>
+#include  <sys/socket.h>
+#include  <netinet/in.h>
+#include  <arpa/inet.h>
+
+#include  "tool.h"
+
+/* howto: 1. start one of the echo servers, e.g. ./server 9899 from
+ *        multioepoll2, and then run: ./echocheck <#ipaddr> <#port>, which
+ *        streams 64 MB of random binary chunks through one connection and
+ *        checks the echo byte for byte. about one byte in four is a zero, so
+ *        a server treating the data as strings is caught.
+ *        example: ./echocheck 127.0.0.1 9899
+ *
+ *        2. options: -n <#bytes> sends that many bytes, -s <#seed> replays
+ *        the chunks of an earlier run, the seed is printed by every run.
+ *        example: ./echocheck -n 1048576 -s 42 127.0.0.1 9899
+ *
+ *        3. the exit status is 0 only if every byte came back intact. it
+ *        is the check of `make check` in multioepoll and multioepoll2.
+ *
+ *        */
+
+/* the bytes sent and not echoed yet, the chunks are kept here until their
+ * echo has been compared */
+#define   CHECK_WINDOW     (1024*1024)
+
+/* the largest chunk generated at once */
+#define   CHECK_CHUNK      (64*1024)
+
+/* how long the echo may stall before the check fails, in ms */
+#define   CHECK_STALL_MS   5000
+
+static void usage(void)
+{
+    printf("usage: ./echocheck [-n #bytes] [-s #seed] <#ipaddr> <#port>\n");
+    exit(EXIT_FAILURE);
+}
+
+/* check_connect: connect to the server and make the socket non-blocking
+ * @ipaddr: the ip address of the server
+ * @port: the port of the server
+ *
+ * return the connected socket
+ *
+ * */
+static int check_connect(const char *ipaddr, int port)
+{
+    struct sockaddr_in servaddr;
+    int fd;
+
+    memset(&servaddr,0,sizeof(servaddr));
+    servaddr.sin_family = AF_INET;
+    servaddr.sin_port = htons(port);
+    if (inet_pton(AF_INET,ipaddr,&servaddr.sin_addr) != 1)
+    {
+        usage();
+    }
+
+    if ( (fd = socket(AF_INET,SOCK_STREAM,0)) < 0 )
+    {
+        perror_exit("socket error");
+    }
+    if (connect(fd,(struct sockaddr *)&servaddr,sizeof(servaddr)) < 0)
+    {
+        perror_exit("connect error");
+    }
+    fcntl(fd,F_SETFL,fcntl(fd,F_GETFL) | O_NONBLOCK);
+
+    return fd;
+}
+
+/* check_chunk: fill @buf with @len random bytes, a quarter of them zero
+ * @buf: the chunk
+ * @len: the bytes of the chunk
+ * @seed: the state of the generator
+ *
+ * */
+static void check_chunk(unsigned char *buf, int len, unsigned int *seed)
+{
+    int i;
+
+    for (i = 0; i < len; ++i)
+    {
+        int r = rand_r(seed);
+        buf[i] = (r & 3) == 0 ? 0 : (unsigned char)(r >> 8);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long long total = 64ULL * 1024 * 1024;
+    unsigned int seed = time(NULL);
+    int opt;
+
+    while ( (opt = getopt(argc,argv,"n:s:")) != -1 )
+    {
+        switch (opt)
+        {
+            case 'n':
+                total = strtoull(optarg,NULL,10);
+                break;
+            case 's':
+                seed = strtoul(optarg,NULL,10);
+                break;
+            default:
+                usage();
+        }
+    }
+
+    if (optind != argc - 2 || total == 0)
+    {
+        usage();
+    }
+    printf("echocheck: seed %u, %llu bytes\n", seed, total);
+
+    int fd = check_connect(argv[optind],atoi(argv[optind + 1]));
+
+    /* the window: [head, sent) is waiting for its echo, [sent, tail) is
+     * still to be written */
+    static unsigned char window[CHECK_WINDOW];
+    static unsigned char recvbuf[CHECK_CHUNK];
+    int head = 0, sent = 0, tail = 0, len = 0;
+    unsigned long long generated = 0, echoed = 0;
+    int nchunks = 0;
+
+    while (echoed < total)
+    {
+        /* the next chunk, once the window has room for it. its length is
+         * drawn only once, so a seed gives the same chunks however the
+         * echo is timed */
+        if (len == 0 && generated < total)
+        {
+            len = 1 + rand_r(&seed) % CHECK_CHUNK;
+            if (generated + len > total)
+            {
+                len = total - generated;
+            }
+        }
+        if (len > 0 && tail - head + len <= CHECK_WINDOW)
+        {
+            if (tail + len > CHECK_WINDOW)
+            {
+                memmove(window,window + head,tail - head);
+                sent -= head;
+                tail -= head;
+                head = 0;
+            }
+            check_chunk(window + tail,len,&seed);
+            tail += len;
+            generated += len;
+            nchunks++;
+            len = 0;
+        }
+
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN | (sent < tail ? POLLOUT : 0);
+        int nready = poll(&pfd,1,CHECK_STALL_MS);
+        if (nready < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror_exit("poll error");
+        }
+        if (nready == 0)
+        {
+            printf("echocheck: FAILED, no echo for %d ms after %llu bytes\n", CHECK_STALL_MS, echoed);
+            exit(EXIT_FAILURE);
+        }
+
+        if (pfd.revents & POLLOUT)
+        {
+            ssize_t n = write(fd,window + sent,tail - sent);
+            if (n < 0 && errno != EAGAIN && errno != EINTR)
+            {
+                perror_exit("write error");
+            }
+            if (n > 0)
+            {
+                sent += n;
+            }
+        }
+
+        if (pfd.revents & (POLLIN | POLLERR | POLLHUP))
+        {
+            ssize_t n = read(fd,recvbuf,sizeof(recvbuf));
+            if (n < 0 && errno != EAGAIN && errno != EINTR)
+            {
+                perror_exit("read error");
+            }
+            if (n == 0)
+            {
+                printf("echocheck: FAILED, the server closed after %llu bytes\n", echoed);
+                exit(EXIT_FAILURE);
+            }
+            if (n > 0)
+            {
+                if (n > sent - head)
+                {
+                    printf("echocheck: FAILED, %zd bytes echoed but only %d sent at byte %llu\n",
+                           n, sent - head, echoed);
+                    exit(EXIT_FAILURE);
+                }
+                if (memcmp(recvbuf,window + head,n) != 0)
+                {
+                    int i = 0;
+                    while (recvbuf[i] == window[head + i])
+                    {
+                        ++i;
+                    }
+                    printf("echocheck: FAILED, byte %llu echoed as 0x%02x instead of 0x%02x\n",
+                           echoed + i, recvbuf[i], window[head + i]);
+                    exit(EXIT_FAILURE);
+                }
+                head += n;
+                echoed += n;
+            }
+        }
+    }
+
+    close(fd);
+    printf("echocheck: ok, %llu bytes in %d chunks echoed intact\n", echoed, nchunks);
+
+    return 0;
+}
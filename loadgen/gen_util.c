@@ -0,0 +1,399 @@
+#include  "gen_util.h"
+
+/* lg_now: the monotonic clock in ns
+ *
+ * */
+long long lg_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* lg_raise_nofile: raise the soft limit of open files to the hard limit, so
+ * thousands of connections fit in one process
+ *
+ * */
+void lg_raise_nofile(void)
+{
+    struct rlimit rl;
+
+    if (getrlimit(RLIMIT_NOFILE,&rl) == 0 && rl.rlim_cur < rl.rlim_max)
+    {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE,&rl);
+    }
+}
+
+/* lg_pattern: the byte at offset @off of the stream of connection @id, it
+ * goes through every value including 0, so a server treating the data as
+ * strings is caught */
+static unsigned char lg_pattern(int id, unsigned long off)
+{
+    return (unsigned char)(off * 7 + (off >> 8) + id);
+}
+
+/* lg_queue: queue the next message of @c, due at @stamp */
+static void lg_queue(lg_thread_t *t, lg_conn_t *c, long long stamp)
+{
+    c->stamps[c->nqueued % LG_INFLIGHT] = stamp;
+    c->nqueued++;
+    c->queued += t->conf->size;
+    t->inflight++;
+}
+
+/* lg_connect: start a non-blocking connect of @c
+ * @t: the thread the connection belongs to
+ * @c: the connection
+ * @epollfd: the epoll set of the thread
+ *
+ * */
+static void lg_connect(lg_thread_t *t, lg_conn_t *c, int epollfd)
+{
+    int on = 1;
+
+    if ( (c->fd = socket(AF_INET,SOCK_STREAM | SOCK_NONBLOCK,0)) < 0 )
+    {
+        perror_exit("socket error");
+    }
+
+    /* the messages are small and latency is measured, no Nagle */
+    setsockopt(c->fd,IPPROTO_TCP,TCP_NODELAY,&on,sizeof(on));
+
+    if (connect(c->fd,(const struct sockaddr *)&t->conf->addr,sizeof(struct sockaddr_in)) < 0
+        && errno != EINPROGRESS)
+    {
+        perror("connect error");
+        close(c->fd);
+        c->fd = -1;
+        t->nfailed++;
+        return;
+    }
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+    ev.data.ptr = c;
+    if (epoll_ctl(epollfd,EPOLL_CTL_ADD,c->fd,&ev) < 0)
+    {
+        perror_exit("epoll control error");
+    }
+}
+
+/* lg_close: drop @c, its messages in flight are not waited for */
+static void lg_close(lg_thread_t *t, lg_conn_t *c)
+{
+    close(c->fd);
+    c->fd = -1;
+    t->inflight -= c->nqueued - c->ndone;
+}
+
+/* lg_read: read and check the echoes of @c until the socket is drained
+ * @t: the thread the connection belongs to
+ * @c: the connection
+ *
+ * return 0, -1 if the connection is broken, -2 if the echo is wrong
+ *
+ * */
+static int lg_read(lg_thread_t *t, lg_conn_t *c)
+{
+    int size = t->conf->size;
+    int i;
+
+    while ( c->readable )
+    {
+        int nread = read(c->fd,t->rbuf,LG_SCRATCH);
+        if (nread < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN)
+            {
+                c->readable = 0;
+                break;
+            }
+            return -1;
+        }
+
+        /* the server closed the connection */
+        else if (nread == 0)
+        {
+            return -1;
+        }
+
+        /* more than was sent, or not what was sent */
+        if (c->recvd + nread > c->sent)
+        {
+            return -2;
+        }
+        for (i = 0; i < nread; ++i)
+        {
+            if ((unsigned char)t->rbuf[i] != lg_pattern(c->id,c->recvd + i))
+            {
+                return -2;
+            }
+        }
+        c->recvd += nread;
+
+        /* the messages completed by this read */
+        long long now = lg_now();
+        while (c->ndone < c->nqueued && c->recvd >= (c->ndone + 1) * size)
+        {
+            hist_record(&t->latency,now - c->stamps[c->ndone % LG_INFLIGHT]);
+            c->ndone++;
+            t->inflight--;
+            t->nmsgs++;
+            t->nbytes += size;
+
+            /* closed loop: the next message goes as soon as the echo is back */
+            if (t->conf->rate == 0 && !t->stopping)
+            {
+                lg_queue(t,c,now);
+            }
+        }
+    }
+
+    return 0;
+}
+
+/* lg_write: write the queued messages of @c until the socket would block
+ * @t: the thread the connection belongs to
+ * @c: the connection
+ *
+ * return 0, -1 if the connection is broken
+ *
+ * */
+static int lg_write(lg_thread_t *t, lg_conn_t *c)
+{
+    int i;
+
+    while ( c->writable && c->sent < c->queued )
+    {
+        int len = c->queued - c->sent < LG_SCRATCH ? c->queued - c->sent : LG_SCRATCH;
+        for (i = 0; i < len; ++i)
+        {
+            t->wbuf[i] = lg_pattern(c->id,c->sent + i);
+        }
+
+        int nwrite = write(c->fd,t->wbuf,len);
+        if (nwrite < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN)
+            {
+                c->writable = 0;
+                break;
+            }
+            return -1;
+        }
+        c->sent += nwrite;
+    }
+
+    return 0;
+}
+
+/* lg_io: move the data of @c in both directions until it would block */
+static int lg_io(lg_thread_t *t, lg_conn_t *c)
+{
+    int ret;
+    unsigned long sent, recvd;
+
+    do
+    {
+        sent = c->sent;
+        recvd = c->recvd;
+
+        if ( (ret = lg_read(t,c)) < 0 || (ret = lg_write(t,c)) < 0 )
+        {
+            return ret;
+        }
+    } while (c->sent != sent || c->recvd != recvd);
+
+    return 0;
+}
+
+/* lg_event: handle the events reported for @c
+ * @t: the thread the connection belongs to
+ * @c: the connection
+ * @events: the events
+ * @interval: the ns between two messages of a connection in open loop
+ *
+ * */
+static void lg_event(lg_thread_t *t, lg_conn_t *c, unsigned events, long long interval)
+{
+    if (c->fd < 0)
+    {
+        return;
+    }
+
+    /* the non-blocking connect has finished */
+    if (c->connected == 0)
+    {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        getsockopt(c->fd,SOL_SOCKET,SO_ERROR,&err,&len);
+        if (err != 0 || (events & (EPOLLERR | EPOLLHUP)))
+        {
+            close(c->fd);
+            c->fd = -1;
+            t->nfailed++;
+            return;
+        }
+        if ((events & EPOLLOUT) == 0)
+        {
+            return;
+        }
+
+        c->connected = 1;
+        t->nconnected++;
+
+        long long now = lg_now();
+        if (t->conf->rate > 0)
+        {
+            /* spread the connections over one interval */
+            c->due = now + interval * c->id / t->conf->nconns;
+        }
+        else if (!t->stopping)
+        {
+            /* the pipeline is filled once, every echo refills it by one */
+            int k;
+            for (k = 0; k < t->conf->depth; ++k)
+            {
+                lg_queue(t,c,now);
+            }
+        }
+    }
+
+    if (events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+    {
+        c->readable = 1;
+    }
+    if (events & EPOLLOUT)
+    {
+        c->writable = 1;
+    }
+
+    int ret = lg_io(t,c);
+    if (ret < 0)
+    {
+        if (ret == -2)
+        {
+            t->nmismatch++;
+        }
+        else if (!t->stopping)
+        {
+            t->nerrors++;
+        }
+        lg_close(t,c);
+    }
+}
+
+/* lg_thread_run: connect the connections of the thread and drive them
+ * until the end of the run, then wait for the messages in flight
+ * @arg: the thread
+ *
+ * */
+void *lg_thread_run(void *arg)
+{
+    lg_thread_t *t = arg;
+    const lg_conf_t *conf = t->conf;
+    struct epoll_event events[EPOLL_EVENTS];
+    int i, nready;
+
+    t->rbuf = malloc(LG_SCRATCH);
+    t->wbuf = malloc(LG_SCRATCH);
+    if (t->rbuf == NULL || t->wbuf == NULL)
+    {
+        perror_exit("malloc error");
+    }
+
+    int epollfd;
+    if ( (epollfd = epoll_create(EPOLL_EVENTS)) < 0 )
+    {
+        perror_exit("epoll create error");
+    }
+
+    for (i = 0; i < t->nconns; ++i)
+    {
+        lg_connect(t,&t->conns[i],epollfd);
+    }
+
+    /* open loop: each connection sends every interval, whatever the
+     * latency, and a message is timed from when it was due */
+    long long interval = conf->rate > 0 ? (long long)(conf->nconns * 1e9 / conf->rate) : 0;
+    long long end = lg_now() + conf->duration * 1000000000LL;
+
+    while ( 1 )
+    {
+        long long now = lg_now();
+        if (!t->stopping && now >= end)
+        {
+            t->stopping = 1;
+        }
+        if (t->stopping && (t->inflight == 0 || now >= end + LG_DRAIN_MS * 1000000LL))
+        {
+            break;
+        }
+
+        if (interval > 0 && !t->stopping)
+        {
+            for (i = 0; i < t->nconns; ++i)
+            {
+                lg_conn_t *c = &t->conns[i];
+                if (c->fd < 0 || c->connected == 0 || c->due > now)
+                {
+                    continue;
+                }
+
+                while (c->due <= now && c->nqueued - c->ndone < LG_INFLIGHT)
+                {
+                    lg_queue(t,c,c->due);
+                    c->due += interval;
+                }
+
+                int ret = lg_write(t,c);
+                if (ret < 0)
+                {
+                    t->nerrors++;
+                    lg_close(t,c);
+                }
+            }
+        }
+
+        if ( (nready = epoll_wait(epollfd,events,EPOLL_EVENTS,interval > 0 ? 1 : 100)) < 0 )
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror_exit("epoll wait error");
+        }
+
+        for (i = 0; i < nready; ++i)
+        {
+            lg_event(t,events[i].data.ptr,events[i].events,interval);
+        }
+    }
+
+    /* a connect still not done by now counts as failed */
+    for (i = 0; i < t->nconns; ++i)
+    {
+        if (t->conns[i].fd >= 0)
+        {
+            if (t->conns[i].connected == 0)
+            {
+                t->nfailed++;
+            }
+            close(t->conns[i].fd);
+        }
+    }
+    close(epollfd);
+    free(t->rbuf);
+    free(t->wbuf);
+
+    return NULL;
+}
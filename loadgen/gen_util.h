@@ -0,0 +1,119 @@
+#ifndef  GEN_UTIL_H
+#define  GEN_UTIL_H
+
+#define   _GNU_SOURCE
+
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  <errno.h>
+#include  <time.h>
+
+#include  <fcntl.h>
+#include  <unistd.h>
+#include  <pthread.h>
+#include  <sys/socket.h>
+#include  <sys/types.h>
+#include  <sys/epoll.h>
+#include  <sys/resource.h>
+#include  <netinet/in.h>
+#include  <netinet/tcp.h>
+#include  <arpa/inet.h>
+
+#include  "tool.h"
+#include  "hist_util.h"
+
+/* lg_conf: what the load generator is asked to do
+ * .addr: the server
+ * .nconns: the number of connections over all threads
+ * .nthreads: the number of threads
+ * .size: the size of a message
+ * .rate: the messages per second over all connections, 0 for closed loop
+ * .depth: the messages each connection keeps in flight in closed loop
+ * .duration: the seconds to run
+ *
+ * */
+typedef struct lg_conf
+{
+    struct sockaddr_in addr;
+    int nconns;
+    int nthreads;
+    int size;
+    double rate;
+    int depth;
+    int duration;
+}lg_conf_t;
+
+/* lg_conn: one connection to the server
+ * .fd: the socket
+ * .id: the index of the connection, it seeds the payload
+ * .connected/.readable/.writable: the state of the socket
+ * .queued: the stream offset the due messages end at
+ * .sent: the stream offset written so far
+ * .recvd: the stream offset echoed back and checked
+ * .nqueued/.ndone: the messages queued and echoed back
+ * .due: when the next message is due in open loop, in ns
+ * .stamps: when each message in flight was due, by message number
+ *
+ * */
+typedef struct lg_conn
+{
+    int fd;
+    int id;
+    int connected;
+    int readable;
+    int writable;
+    unsigned long queued;
+    unsigned long sent;
+    unsigned long recvd;
+    unsigned long nqueued;
+    unsigned long ndone;
+    long long due;
+    long long stamps[LG_INFLIGHT];
+}lg_conn_t;
+
+/* lg_thread: one thread driving its share of the connections
+ * .id/.tid: the index and the thread
+ * .conf: the run
+ * .conns/.nconns: its connections
+ * .rbuf/.wbuf: the scratch buffers the echoes are checked and the payload
+ * generated in
+ * .inflight: the messages sent and not echoed back yet
+ * .stopping: the run is over, only the messages in flight are waited for
+ * .latency: the latency of the messages, in ns
+ * .nmsgs/.nbytes: the messages and bytes echoed back during the run
+ * .nconnected/.nfailed: the connections established and refused
+ * .nerrors: the connections broken during the run
+ * .nmismatch: the connections that got back something they did not send
+ *
+ * */
+typedef struct lg_thread
+{
+    int id;
+    pthread_t tid;
+    const lg_conf_t *conf;
+    lg_conn_t *conns;
+    int nconns;
+    char *rbuf;
+    char *wbuf;
+    long inflight;
+    int stopping;
+    hist_t latency;
+    long nmsgs;
+    long long nbytes;
+    int nconnected;
+    int nfailed;
+    int nerrors;
+    int nmismatch;
+}lg_thread_t;
+
+/* the monotonic clock in ns */
+long long lg_now(void);
+
+/* raise the open files limit to the hard limit */
+void lg_raise_nofile(void);
+
+/* run the load of one thread until the end of the run */
+void *lg_thread_run(void *arg);
+
+#endif  /*GEN_UTIL_H*/
@@ -0,0 +1,169 @@
+#include  "gen_util.h"
+
+/* howto: 1. start one of the echo servers, e.g. ./server 9899 from
+ *        multioepoll2, and then run: ./loadgen <#ipaddr> <#port>, which
+ *        keeps 100 connections echoing 64-byte messages for 10 seconds.
+ *        example: ./loadgen 127.0.0.1 9899
+ *
+ *        2. options: -c <#conns> connections, spread over -t <#threads>
+ *        threads, each sending -s <#bytes> messages for -d <#seconds>.
+ *        without -r every connection sends its next message as soon as the
+ *        echo of the previous one is back (closed loop). -r <#msgs/s> sends
+ *        at that rate over all connections whatever the latency (open loop),
+ *        the latency of a message is counted from when it was due.
+ *        example: ./loadgen -c 10000 -t 4 -s 1024 -r 50000 -d 30 127.0.0.1 9899
+ *
+ *        -p <#depth> pipelines the closed loop: every connection keeps that
+ *        many messages in flight (default: 1, at most 256), written back to
+ *        back, which is how a server batching its replies is measured.
+ *        example: ./loadgen -c 100 -p 16 127.0.0.1 9899
+ *
+ *        3. every byte echoed back is checked. the report gives the
+ *        throughput and the latency percentiles, the exit status is not 0
+ *        if any echo was wrong or no connection could be made. -H also
+ *        prints the latency histogram buckets, which runs can be merged by.
+ *
+ *        */
+
+static void usage(void)
+{
+    printf("usage: ./loadgen [-c #conns] [-t #threads] [-s #bytes] [-r #msgs/s] [-p #depth] [-d #seconds] [-H] <#ipaddr> <#port>\n");
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+    lg_conf_t conf;
+    int print_hist = 0;
+    int opt, i;
+
+    memset(&conf,0,sizeof(conf));
+    conf.nconns = 100;
+    conf.nthreads = 1;
+    conf.size = 64;
+    conf.depth = 1;
+    conf.duration = 10;
+
+    while ( (opt = getopt(argc,argv,"c:t:s:r:p:d:H")) != -1 )
+    {
+        switch (opt)
+        {
+            case 'c':
+                conf.nconns = atoi(optarg);
+                break;
+            case 't':
+                conf.nthreads = atoi(optarg);
+                break;
+            case 's':
+                conf.size = atoi(optarg);
+                break;
+            case 'r':
+                conf.rate = atof(optarg);
+                break;
+            case 'p':
+                conf.depth = atoi(optarg);
+                break;
+            case 'd':
+                conf.duration = atoi(optarg);
+                break;
+            case 'H':
+                print_hist = 1;
+                break;
+            default:
+                usage();
+        }
+    }
+
+    if (optind != argc - 2 || conf.nconns <= 0 || conf.nthreads <= 0 ||
+        conf.size <= 0 || conf.rate < 0 || conf.duration <= 0 ||
+        conf.depth <= 0 || conf.depth > LG_INFLIGHT)
+    {
+        usage();
+    }
+    if (conf.nthreads > conf.nconns)
+    {
+        conf.nthreads = conf.nconns;
+    }
+
+    conf.addr.sin_family = AF_INET;
+    conf.addr.sin_port = htons(atoi(argv[optind + 1]));
+    if (inet_pton(AF_INET,argv[optind],&conf.addr.sin_addr) <= 0)
+    {
+        usage();
+    }
+
+    lg_raise_nofile();
+
+    /* the connections are split into one block per thread */
+    lg_thread_t *threads = calloc(conf.nthreads,sizeof(lg_thread_t));
+    lg_conn_t *conns = calloc(conf.nconns,sizeof(lg_conn_t));
+    if (threads == NULL || conns == NULL)
+    {
+        perror_exit("calloc error");
+    }
+
+    int start = 0;
+    for (i = 0; i < conf.nthreads; ++i)
+    {
+        lg_thread_t *t = &threads[i];
+        t->id = i;
+        t->conf = &conf;
+        t->conns = conns + start;
+        t->nconns = (conf.nconns - i + conf.nthreads - 1) / conf.nthreads;
+        start += t->nconns;
+    }
+    for (i = 0; i < conf.nconns; ++i)
+    {
+        conns[i].fd = -1;
+        conns[i].id = i;
+    }
+
+    for (i = 0; i < conf.nthreads; ++i)
+    {
+        if (pthread_create(&threads[i].tid,NULL,lg_thread_run,&threads[i]) != 0)
+        {
+            perror_exit("pthread create error");
+        }
+    }
+
+    /* merge the results of the threads */
+    static hist_t latency;
+    long nmsgs = 0;
+    long long nbytes = 0;
+    int nconnected = 0, nfailed = 0, nerrors = 0, nmismatch = 0;
+    for (i = 0; i < conf.nthreads; ++i)
+    {
+        pthread_join(threads[i].tid,NULL);
+        hist_merge(&latency,&threads[i].latency);
+        nmsgs += threads[i].nmsgs;
+        nbytes += threads[i].nbytes;
+        nconnected += threads[i].nconnected;
+        nfailed += threads[i].nfailed;
+        nerrors += threads[i].nerrors;
+        nmismatch += threads[i].nmismatch;
+    }
+
+    printf("conns %d threads %d size %d rate %.0f depth %d duration %d\n",
+           conf.nconns,conf.nthreads,conf.size,conf.rate,conf.depth,conf.duration);
+    printf("connected %d failed %d errors %d mismatches %d\n",
+           nconnected,nfailed,nerrors,nmismatch);
+    printf("messages %ld bytes %lld throughput %.1f msg/s %.2f MB/s\n",
+           nmsgs,nbytes,(double)nmsgs / conf.duration,
+           (double)nbytes / conf.duration / (1024 * 1024));
+    printf("latency(us) p50 %.1f p99 %.1f p99.9 %.1f max %.1f\n",
+           hist_percentile(&latency,50) / 1000.0,hist_percentile(&latency,99) / 1000.0,
+           hist_percentile(&latency,99.9) / 1000.0,hist_percentile(&latency,100) / 1000.0);
+
+    /* the buckets, so runs can be merged later */
+    if (print_hist)
+    {
+        static char buf[64 * 1024];
+        hist_serialize(&latency,buf,sizeof(buf));
+        printf("latency buckets %s\n",buf);
+    }
+
+    free(conns);
+    free(threads);
+
+    return (nmismatch > 0 || nconnected == 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
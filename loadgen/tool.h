@@ -0,0 +1,22 @@
+#ifndef  TOOL_H
+#define  TOOL_H
+
+#include  <stdio.h>
+#include  <errno.h>
+
+#define   perror_exit(strinfo)    do { perror(strinfo); \
+                                       exit(EXIT_FAILURE); \
+                                  } while(0);
+
+#define   EPOLL_EVENTS 1000
+
+/* the most messages in flight on one connection in open loop */
+#define   LG_INFLIGHT      256
+
+/* the scratch buffer each thread generates and checks the payload in */
+#define   LG_SCRATCH       64*1024
+
+/* how long the in-flight messages may take to come back after the run */
+#define   LG_DRAIN_MS      2000
+
+#endif  /*TOOL_H*/
@@ -1,15 +1,29 @@
 #include  "buffer_util.h"
 
+#include  <errno.h>
+
 void buffer_init(struct io_buffer *buf)
 {
-    buf = malloc(sizeof(struct io_buffer));
-    assert(buf);
-    memset(buf,0,sizeof(struct io_buffer));
+    buffer_init_size(buf,BUFSIZE,BUFMAXSIZE);
+}
+
+void buffer_init_size(struct io_buffer *buf, unsigned int size, unsigned int maxsize)
+{
+    /* the masking needs power of two sizes */
+    assert(size && (size & (size - 1)) == 0);
+    assert(maxsize >= size && (maxsize & (maxsize - 1)) == 0);
+
+    buf->buffer = malloc(size);
+    assert(buf->buffer);
+    buf->size = size;
+    buf->maxsize = maxsize;
+    buf->in = 0;
+    buf->out = 0;
 }
 
 int buffer_hasspace(const struct io_buffer *buf)
 {
-    return (BUFSIZE-1) - buf->in;
+    return buf->size - (buf->in - buf->out);
 }
 
 int buffer_hasdata(const struct io_buffer *buf)
@@ -17,13 +31,174 @@ int buffer_hasdata(const struct io_buffer *buf)
     return buf->in - buf->out;
 }
 
+/* only the positions are reset, the stale bytes are never read again */
 void buffer_reset(struct io_buffer *buf)
 {
-    memset(buf,0,sizeof(struct io_buffer));
+    buf->in = 0;
+    buf->out = 0;
 }
 
 void buffer_destroy(struct io_buffer *buf)
 {
-    free(buf);
-    buf = NULL;
+    free(buf->buffer);
+    buf->buffer = NULL;
+}
+
+int buffer_grow(struct io_buffer *buf)
+{
+    if (buf->size >= buf->maxsize)
+    {
+        return -1;
+    }
+
+    /* unwrap the data to the start of the new buffer */
+    struct iovec iov[2];
+    int i, nseg = buffer_data_iov(buf,iov);
+    int ndata = buffer_hasdata(buf);
+
+    char *buffer = malloc(buf->size * 2);
+    assert(buffer);
+
+    char *pos = buffer;
+    for (i = 0; i < nseg; ++i)
+    {
+        memcpy(pos,iov[i].iov_base,iov[i].iov_len);
+        pos += iov[i].iov_len;
+    }
+
+    free(buf->buffer);
+    buf->buffer = buffer;
+    buf->size *= 2;
+    buf->out = 0;
+    buf->in = ndata;
+    return 0;
+}
+
+int buffer_space_iov(const struct io_buffer *buf, struct iovec iov[2])
+{
+    unsigned int space = buffer_hasspace(buf);
+    unsigned int pos = buf->in & (buf->size - 1);
+    unsigned int first = buf->size - pos;
+
+    if (space == 0)
+    {
+        return 0;
+    }
+
+    iov[0].iov_base = buf->buffer + pos;
+    if (space <= first)
+    {
+        iov[0].iov_len = space;
+        return 1;
+    }
+
+    iov[0].iov_len = first;
+    iov[1].iov_base = buf->buffer;
+    iov[1].iov_len = space - first;
+    return 2;
+}
+
+int buffer_data_iov(const struct io_buffer *buf, struct iovec iov[2])
+{
+    unsigned int ndata = buffer_hasdata(buf);
+    unsigned int pos = buf->out & (buf->size - 1);
+    unsigned int first = buf->size - pos;
+
+    if (ndata == 0)
+    {
+        return 0;
+    }
+
+    iov[0].iov_base = buf->buffer + pos;
+    if (ndata <= first)
+    {
+        iov[0].iov_len = ndata;
+        return 1;
+    }
+
+    iov[0].iov_len = first;
+    iov[1].iov_base = buf->buffer;
+    iov[1].iov_len = ndata - first;
+    return 2;
+}
+
+void buffer_produce(struct io_buffer *buf, int n)
+{
+    buf->in += n;
+}
+
+void buffer_consume(struct io_buffer *buf, int n)
+{
+    buf->out += n;
+
+    /* all data has been taken out, start over so the next data does not
+     * wrap around */
+    if (buf->in == buf->out)
+    {
+        buffer_reset(buf);
+    }
+}
+
+int buffer_put(struct io_buffer *buf, const char *data, int n)
+{
+    while (buffer_hasspace(buf) < n)
+    {
+        if (buffer_grow(buf) < 0)
+        {
+            break;
+        }
+    }
+
+    struct iovec iov[2];
+    int i, nseg = buffer_space_iov(buf,iov);
+    int ncopy = 0;
+
+    for (i = 0; i < nseg && ncopy < n; ++i)
+    {
+        int len = iov[i].iov_len < (size_t)(n - ncopy) ? (int)iov[i].iov_len : n - ncopy;
+        memcpy(iov[i].iov_base,data + ncopy,len);
+        ncopy += len;
+    }
+
+    buffer_produce(buf,ncopy);
+    return ncopy;
+}
+
+/* the lengths come from the positions only, never from the content, so any
+ * binary data including zero bytes goes through untouched */
+int buffer_readfd(struct io_buffer *buf, int fd)
+{
+    struct iovec iov[2];
+    int nseg = buffer_space_iov(buf,iov);
+
+    if (nseg == 0)
+    {
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    int nread = readv(fd,iov,nseg);
+    if (nread > 0)
+    {
+        buffer_produce(buf,nread);
+    }
+    return nread;
+}
+
+int buffer_writefd(struct io_buffer *buf, int fd)
+{
+    struct iovec iov[2];
+    int nseg = buffer_data_iov(buf,iov);
+
+    if (nseg == 0)
+    {
+        return 0;
+    }
+
+    int nwrite = writev(fd,iov,nseg);
+    if (nwrite > 0)
+    {
+        buffer_consume(buf,nwrite);
+    }
+    return nwrite;
 }
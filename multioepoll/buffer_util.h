@@ -4,28 +4,65 @@
 #include  <stdlib.h>
 #include  <assert.h>
 #include  <string.h>
+#include  <sys/uio.h>
 
-/* set the buffer size to 4K */
+/* set the initial buffer size to 4K, a power of two */
 #define   BUFSIZE    4*1024
 
-/* io_buffer: used to manage the buffer for io 
+/* the size a buffer may grow up to, a power of two */
+#define   BUFMAXSIZE 64*1024
+
+/* io_buffer: a ring buffer used to manage the buffer for io
  * .buffer: the io buffer
- * .in: the position the input into
- * .out: the position the output from
+ * .size: the capacity of the buffer, a power of two
+ * .maxsize: the capacity the buffer may grow up to
+ * .in: the position the input into, counting up without wrapping
+ * .out: the position the output from, counting up without wrapping
+ *
+ * the data lives in [out, in), masked by size - 1 it may wrap around the
+ * end of .buffer, so both the data and the free space are viewed as at
+ * most two segments, ready for readv and writev
  *
  * */
 typedef struct io_buffer
 {
-    char buffer[BUFSIZE];
-    int in;
-    int out;
+    char *buffer;
+    unsigned int size;
+    unsigned int maxsize;
+    unsigned int in;
+    unsigned int out;
 }buffer_t;
 
 void buffer_init(struct io_buffer *buf);
+void buffer_init_size(struct io_buffer *buf, unsigned int size, unsigned int maxsize);
 int buffer_hasspace(const struct io_buffer *buf);
 int buffer_hasdata(const struct io_buffer *buf);
 void buffer_reset(struct io_buffer *buf);
 void buffer_destroy(struct io_buffer *buf);
 
+/* double the capacity up to .maxsize, return -1 if it is already there */
+int buffer_grow(struct io_buffer *buf);
+
+/* the free space as at most two segments, return the number of segments */
+int buffer_space_iov(const struct io_buffer *buf, struct iovec iov[2]);
+
+/* the data as at most two segments, return the number of segments */
+int buffer_data_iov(const struct io_buffer *buf, struct iovec iov[2]);
+
+/* account @n bytes written into the free space */
+void buffer_produce(struct io_buffer *buf, int n);
+
+/* account @n bytes taken out of the data */
+void buffer_consume(struct io_buffer *buf, int n);
+
+/* copy @n bytes of @data in, growing if needed, return the bytes copied */
+int buffer_put(struct io_buffer *buf, const char *data, int n);
+
+/* read from @fd into the free space, return what read returns */
+int buffer_readfd(struct io_buffer *buf, int fd);
+
+/* write the data to @fd, return what write returns */
+int buffer_writefd(struct io_buffer *buf, int fd);
+
 
 #endif  /*BUFFER_UTIL_H*/
@@ -12,20 +12,47 @@
  *        3. type the combo keys "ctrl+d" meaning "EOF" by client will cause
  *        the client and server to close the connection.
  *
+ *        4. -b <#backlog> sets the listen backlog, the completed
+ *        connections the kernel queues until they are accepted (default:
+ *        /proc/sys/net/core/somaxconn, which also caps it).
+ *        example: ./server -b 1024 9899
+ *
  *        */
 
+static void usage(void)
+{
+    printf("usage: ./server [-b #backlog] <#port>\n");
+    exit(EXIT_FAILURE);
+}
+
 int main(int argc, char *argv[])
 {
-    if (argc != 2)
+    int backlog = default_backlog();
+    int opt;
+
+    while ( (opt = getopt(argc,argv,"b:")) != -1 )
     {
-        printf("usage: ./server <#port>\n");
-        exit(EXIT_FAILURE);
+        switch (opt)
+        {
+            case 'b':
+                backlog = atoi(optarg);
+                break;
+            default:
+                usage();
+        }
     }
-    int port = atoi(argv[1]);
 
-    int listenfd = bind_sock(port);
+    if (optind != argc - 1 || backlog <= 0)
+    {
+        usage();
+    }
+    int port = atoi(argv[optind]);
+
+    log_init(STDOUT_FILENO,LOG_INFO);
+
+    int listenfd = bind_sock(port,0);
 
-    listen_sock(listenfd);
+    listen_sock(listenfd,backlog);
 
     handle_connection(listenfd);
 
@@ -1,45 +1,37 @@
 #include  "sock_util.h"
 
-/* sock_bind: create and bind a new socket with @port
- * @port: the port used to bind the socket
+/* get_buf: the receive buffer of @fd, the table grows to hold any fd and the
+ * buffer is allocated on the first read of the connection
+ * @bufs: the buffers indexed by fd
+ * @nbufs: the number of entries of @bufs
+ * @fd: the connected fd
  *
  * */
-int bind_sock(int port)
+static buffer_t *get_buf(buffer_t **bufs, int *nbufs, int fd)
 {
-    int listenfd;
-    struct sockaddr_in socket_addr;
-
-    /* create a new socket */
-    if ((listenfd = socket(AF_INET,SOCK_STREAM,0)) < 0)
+    if (fd >= *nbufs)
     {
-        perror_exit("socket error");
-    }
-
-    /* fill the socket address struct */
-    memset(&socket_addr,0,sizeof(struct sockaddr_in));
-    socket_addr.sin_family = AF_INET;
-    socket_addr.sin_port = htons(port);
-    socket_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        int size = *nbufs ? *nbufs : 1024;
+        while (fd >= size)
+        {
+            size *= 2;
+        }
 
-    /* bind the socket */
-    if (bind(listenfd,(struct sockaddr *)&socket_addr,sizeof(struct sockaddr_in)) < 0)
-    {
-        perror_exit("bind error");
+        *bufs = realloc(*bufs,size * sizeof(buffer_t));
+        if (*bufs == NULL)
+        {
+            perror_exit("realloc error");
+        }
+        memset(*bufs + *nbufs,0,(size - *nbufs) * sizeof(buffer_t));
+        *nbufs = size;
     }
 
-    return listenfd;
-}
-
-/* sock_listen: listen the @listenfd socket
- * @listenfd: the socket used for listening
- *
- * */
-void listen_sock(int listenfd)
-{
-    if (listen(listenfd,LISTENQ) < 0)
+    buffer_t *buf = &(*bufs)[fd];
+    if (buf->buffer == NULL)
     {
-        perror_exit("listen error");
+        buffer_init(buf);
     }
+    return buf;
 }
 
 /* handle_connection: handle the connected clients
@@ -51,12 +43,14 @@ void handle_connection(int listenfd)
     /* the number of readable fds in the pollfd array */
     int nready, i;
 
-    /* receive buffer */
-    buffer_t recvbuf;
-    memset(&recvbuf,0,sizeof(buffer_t));
+    /* the receive buffer of each connection, the echo of one client never
+     * mixes with the data of another */
+    buffer_t *recvbufs = NULL;
+    int nrecvbufs = 0;
 
-    /* set the listenfd to non-block */
-    //setnonblock(listenfd);
+    /* set the listenfd to non-block, so a batch of accepts stops once the
+     * backlog is drained */
+    setnonblock(listenfd);
 
     /* epollfd set to monitor the related events */
     int epollfd;
@@ -94,61 +88,61 @@ void handle_connection(int listenfd)
             /* connected sockets are ready */
             else if ( events[i].events & EPOLLIN )
             {
-                do_read(fd,epollfd,&recvbuf);
+                do_read(fd,epollfd,get_buf(&recvbufs,&nrecvbufs,fd));
             }
 
             /* read the data from the connected socket and echo it also */
             else if ( events[i].events & EPOLLOUT )
             {
-                do_write(fd,epollfd,&recvbuf);
+                do_write(fd,epollfd,get_buf(&recvbufs,&nrecvbufs,fd));
             }
         }
     }
 }
 
-/* do_accept: establish the new connection
+/* do_accept: establish up to ACCEPT_BATCH new connections, the listen
+ * socket is level triggered so the connections left behind by a full batch
+ * are reported again by the next epoll_wait, after the established ones
  * @listenfd: the listening fd
  * @epollfd: the epollfd used to monitor the listening fd and new connected fd
  *
  * */
 void do_accept(int listenfd, int epollfd)
 {
-    int connfd;
+    int connfd, n;
     struct sockaddr_in clitaddr;
     socklen_t socklen;
-    //while ( (connfd = accept(listenfd,(struct sockaddr *)&clitaddr,&socklen)) > 0 )
-    //{
-    connfd = accept(listenfd,(struct sockaddr *)&clitaddr,&socklen);
-        /* show client info */
-        show_peer_info(connfd);
 
-        /* set the connfd to non-block socket */
-        //setnonblock(connfd);
+    for (n = 0; n < ACCEPT_BATCH; ++n)
+    {
+        /* the connections stay blocking, the reads and writes rely on it */
+        socklen = sizeof(struct sockaddr_in);
+        if ( (connfd = accept4(listenfd,(struct sockaddr *)&clitaddr,&socklen,SOCK_CLOEXEC)) < 0 )
+        {
+            /* if accept error*/
+            if (errno != EAGAIN && errno != EINTR && errno != ECONNABORTED && errno != EPROTO)
+            {
+                perror_exit("accept error");
+            }
+            break;
+        }
 
-        /* set the connfd events to EPOLLIN | EPLLET(edge trigger) */
-        //int state =  EPOLLIN | EPOLLET;
+        /* show client info */
+        log_addr_info(&clitaddr);
+
+        /* set the connfd events to EPOLLIN, level trigger */
         int state = EPOLLIN;
 
         /* add connected fd to epoll set */
         add_epoll_event(epollfd,connfd,state);
-    //}
-
-    /* if accept error*/
-    if (connfd < 0)
-    {
-        if (errno != EINTR)
-        {
-            perror_exit("accept error");
-        }
     }
 }
 
 void do_read(int fd, int epollfd, buffer_t *recvbuf)
 {
-    int space = buffer_hasspace(recvbuf);
-    if (space > 0)
+    if (buffer_hasspace(recvbuf) > 0)
     {
-        int nread = read(fd,recvbuf->buffer + recvbuf->in,space);
+        int nread = buffer_readfd(recvbuf,fd);
 
         /* read error */
         if (nread < 0)
@@ -156,17 +150,16 @@ void do_read(int fd, int epollfd, buffer_t *recvbuf)
             perror_exit("read error");
         }
 
-        /* read "FIN" from client */
+        /* read "FIN" from client, the buffer goes with the connection */
         else if (nread == 0)
         {
             delete_epoll_event(epollfd,fd,EPOLLIN);
             close(fd);
+            buffer_destroy(recvbuf);
         }
 
         else
         {
-            recvbuf->in += nread;
-
             /* data is ready for writing */
             modify_epoll_event(epollfd,fd,EPOLLOUT);
         }
@@ -175,9 +168,7 @@ void do_read(int fd, int epollfd, buffer_t *recvbuf)
 
 void do_write(int fd,int epollfd,buffer_t *sendbuf)
 {
-    int ntotal = strlen(sendbuf->buffer);
-
-    int nwrite = write(fd,sendbuf->buffer + sendbuf->out,ntotal);
+    int nwrite = buffer_writefd(sendbuf,fd);
 
     if (nwrite < 0)
     {
@@ -186,45 +177,47 @@ void do_write(int fd,int epollfd,buffer_t *sendbuf)
 
     else
     {
-        sendbuf->out += ntotal;
-        /* all data has been sent out, reset the buffer space */
-        if ( sendbuf->in == sendbuf->out )
+        if ( buffer_hasdata(sendbuf) == 0 )
         {
-            buffer_reset(sendbuf);
-
             /* modify the fd from epoll set to EPOLLIN since all data has been sent out */
             modify_epoll_event(epollfd,fd,EPOLLIN);
         }
     }
 }
 
-/* show_client_info: show the client information including ip address and port
- * @connfd: the connected fd used to show the information
+
+/* set_epoll_event: register @fd in the @epollfd set for exactly @state,
+ * adding, modifying or deleting it as needed
+ * @epollfd: the epoll set
+ * @fd: the fd to be registered
+ * @cur: the events the fd is registered for now, 0 if it is not in the set
+ * @state: the events the fd should be registered for, 0 to remove it
  *
  * */
-void show_peer_info(int connfd)
+static void set_epoll_event(int epollfd, int fd, int *cur, int state)
 {
-    struct sockaddr_in clitaddr;
-    socklen_t socklen;
-
-    if ((getpeername(connfd,(struct sockaddr *)&clitaddr,&socklen)) < 0)
+    if (state == *cur)
     {
-        perror_exit("getpeername error");
+        return;
     }
 
-    char ipaddr[20];
-
-    if (inet_ntop(AF_INET,&clitaddr.sin_addr,ipaddr,socklen) < 0)
+    if (*cur == 0)
     {
-        perror_exit("inet_ntop error");
+        add_epoll_event(epollfd,fd,state);
     }
-
-    int port = ntohs(clitaddr.sin_port);
-    printf("peer information: %s:%d\n", ipaddr, port);
+    else if (state == 0)
+    {
+        delete_epoll_event(epollfd,fd,*cur);
+    }
+    else
+    {
+        modify_epoll_event(epollfd,fd,state);
+    }
+    *cur = state;
 }
 
-
-/* client handle the info received from both server and standard input
+/* client handle the info received from both server and standard input, the
+ * data is carried by length only so any binary input is echoed untouched
  * @connfd: the connected socket used for communication
  *
  */
@@ -232,14 +225,16 @@ void client_info(int connfd)
 {
     int i;
 
-    int shutdown_flag = 0;
+    /* "EOF" has been read from standard input, and "FIN" sent after it */
+    int stdin_eof = 0, shutdown_flag = 0;
+
+    /* the events each fd is registered for */
+    int instate = 0, connstate = 0, outstate = 0;
 
     /* recv and send buffer */
     buffer_t recvbuf, sendbuf;
-    memset(&recvbuf,0,sizeof(buffer_t));
-    memset(&sendbuf,0,sizeof(buffer_t));
-
-    //setnonblock(connfd);
+    buffer_init(&recvbuf);
+    buffer_init(&sendbuf);
 
     /* epollfd set monitors conncted socket fd and standard input, if either one is
      * readable, then we obtain the info from it*/
@@ -251,216 +246,109 @@ void client_info(int connfd)
     struct epoll_event events[4];
     int nready;
 
-    add_epoll_event(epollfd,STDIN_FILENO,EPOLLIN);
-
     while( 1 )
     {
+        /* every fd waits for what the buffers let it do next: read while
+         * there is space, write while there is data */
+        set_epoll_event(epollfd,STDIN_FILENO,&instate,
+                (!stdin_eof && buffer_hasspace(&sendbuf) > 0) ? EPOLLIN : 0);
+        set_epoll_event(epollfd,connfd,&connstate,
+                (buffer_hasspace(&recvbuf) > 0 ? EPOLLIN : 0) | (buffer_hasdata(&sendbuf) > 0 ? EPOLLOUT : 0));
+        set_epoll_event(epollfd,STDOUT_FILENO,&outstate,
+                buffer_hasdata(&recvbuf) > 0 ? EPOLLOUT : 0);
+
         if ( (nready = epoll_wait(epollfd,events,4,INFTIM)) < 0 )
         {
-            perror("epollfd error");
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror_exit("epollfd error");
         }
 
         for (i = 0; i < nready; ++i)
         {
             fd = events[i].data.fd;
 
-            if (fd == STDIN_FILENO && (events[i].events & EPOLLIN) )
+            if (fd == STDIN_FILENO && (events[i].events & (EPOLLIN | EPOLLHUP)) )
             {
-                int space = buffer_hasspace(&sendbuf);
-                if (space > 0)
-                {
-                    int nread = read(fd,&sendbuf.buffer[sendbuf.in],space);
-
-                    /* read error */
-                    if (nread < 0)
-                    {
-                        if (errno != EINTR)
-                        {
-                            perror_exit("read error");
-                        }
-                    }
+                int nread = buffer_readfd(&sendbuf,fd);
 
-                    else if (nread == 0)
+                /* read error */
+                if (nread < 0)
+                {
+                    if (errno != EINTR)
                     {
-                        /* read "ctrl+d" from client, close the connection and delete the event from epoll set */
-                        shutdown_flag = 1;
-                        shutdown(connfd,SHUT_WR);
-                        delete_epoll_event(epollfd,fd, EPOLLIN);
+                        perror_exit("read error");
                     }
+                }
 
-                    else
-                    {
-                        sendbuf.in += nread;
-
-                        /* add connection fd to epoll set */
-                        add_epoll_event(epollfd,connfd,EPOLLOUT);
-                    }
+                /* read "ctrl+d" from client, the connection is shut down
+                 * once the data before it has been sent */
+                else if (nread == 0)
+                {
+                    stdin_eof = 1;
                 }
             }
 
             if (fd == connfd && (events[i].events & EPOLLOUT) )
             {
-                int ntotal = strlen(sendbuf.buffer);
-
-                int nwrite = write(fd,&sendbuf.buffer[sendbuf.out],ntotal);
-
-                if (nwrite < 0)
+                if (buffer_writefd(&sendbuf,fd) < 0)
                 {
                     perror_exit("write error");
                 }
-
-                else
-                {
-                    sendbuf.out += ntotal;
-
-                    /* all data has benn sent out, reset the buffer space */
-                    if (sendbuf.in == sendbuf.out)
-                    {
-                        buffer_reset(&sendbuf);
-                    }
-
-                    /* modify the fd from epoll set to EPOLLIN since all data has been sent out */
-                    modify_epoll_event(epollfd,fd,EPOLLIN);
-                }
             }
 
-            if (fd == connfd && (events[i].events & EPOLLIN) )
+            if (fd == connfd && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) )
             {
-                int space = buffer_hasspace(&recvbuf);
-                if (space > 0)
+                int nread = buffer_readfd(&recvbuf,fd);
+
+                /* read error */
+                if (nread < 0)
                 {
-                    int nread = read(fd,&recvbuf.buffer[recvbuf.in],space);
+                    perror_exit("read error");
+                }
 
-                    /* read error */
-                    if (nread < 0)
+                /* read "FIN" from server */
+                else if (nread == 0)
+                {
+                    /* we have sent "FIN" already */
+                    if (shutdown_flag == 0)
                     {
-                        perror_exit("read error");
+                        printf("server terminates unexpectedly!\n");
+                        exit(EXIT_FAILURE);
                     }
 
-                    /* read "FIN" from server */
-                    else if (nread == 0)
+                    /* the last echoed data goes out before we leave */
+                    while (buffer_hasdata(&recvbuf) > 0)
                     {
-                        /* we have sent "FIN" already */
-                        if (shutdown_flag == 0)
+                        if (buffer_writefd(&recvbuf,STDOUT_FILENO) < 0 && errno != EAGAIN && errno != EINTR)
                         {
-                            printf("server terminates unexpectedly!\n");
-                            exit(EXIT_FAILURE);
+                            perror_exit("write error");
                         }
-                        else
-                            return;
-                    }
-
-                    else
-                    {
-                        recvbuf.in += nread;
-
-                        /* add STDOUT_FILENO to epoll set */
-                        delete_epoll_event(epollfd,connfd,EPOLLIN);
-                        add_epoll_event(epollfd,STDOUT_FILENO,EPOLLOUT);
                     }
+                    return;
                 }
             }
 
             if (fd == STDOUT_FILENO && (events[i].events & EPOLLOUT) )
             {
-                int ntotal = strlen(recvbuf.buffer);
-
-                int nwrite = write(fd,&recvbuf.buffer[recvbuf.out],ntotal);
-
-                if (nwrite < 0)
+                if (buffer_writefd(&recvbuf,fd) < 0)
                 {
                     if (errno != EAGAIN)
                     {
                         perror_exit("write error");
                     }
                 }
-
-                else
-                {
-                    recvbuf.out += ntotal;
-
-                    /* all data has been sent to STANDARD OUTPUT, reset
-                     * the buffer space */
-                    if (recvbuf.in == recvbuf.out)
-                    {
-                        buffer_reset(&recvbuf);
-
-                        delete_epoll_event(epollfd,STDOUT_FILENO,EPOLLOUT);
-                    }
-                }
             }
         }
-    }
-}
 
-/* add_epoll_event: add an @fd into @epollfd set
- * @epollfd: the epoll set the fd added into
- * @fd: the fd to be added into the epoll set
- * @state: the related event of the fd to be add
- *
- * */
-void add_epoll_event(int epollfd, int fd, int state)
-{
-    struct epoll_event ev;
-    ev.events = state;
-    ev.data.fd = fd;
-    if (epoll_ctl(epollfd,EPOLL_CTL_ADD,fd,&ev) < 0 )
-    {
-        perror_exit("epoll control error");
-    }
-}
-
-/* modify_epoll_event: modify an @fd in the @epollfd set
- * @epollfd: the epoll set the fd belongs to
- * @fd: the fd to be modified in the epoll set
- * @state: the related event of fd the to be modified
- *
- * */
-void modify_epoll_event(int epollfd, int fd, int state)
-{
-    struct epoll_event ev;
-    ev.events = state;
-    ev.data.fd = fd;
-    if (epoll_ctl(epollfd,EPOLL_CTL_MOD,fd,&ev) < 0 )
-    {
-        perror_exit("epoll control error");
-    }
-}
-
-/* delete_epoll_event: delete an @fd from @epollfd set
- * @epollfd: the epoll set the fd to be deleted from
- * @fd: the fd to be deleted in the epoll set
- * @state: the related event of the fd to be deleted
- *
- * */
-void delete_epoll_event(int epollfd, int fd, int state)
-{
-    struct epoll_event ev;
-    ev.events = state;
-    ev.data.fd = fd;
-    if (epoll_ctl(epollfd,EPOLL_CTL_DEL,fd,&ev) < 0 )
-    {
-        perror_exit("epoll control error");
+        /* all data typed before "ctrl+d" has been sent, send "FIN" */
+        if (stdin_eof && !shutdown_flag && buffer_hasdata(&sendbuf) == 0)
+        {
+            shutdown_flag = 1;
+            shutdown(connfd,SHUT_WR);
+        }
     }
 }
 
-/* setnonblock: set the non-blocking @fd
- * @fd: the fd to be set
- *
- * */
-void setnonblock(int fd)
-{
-    int opt;
-    /* get the orignal option */
-    if ( (opt = fcntl(fd,F_GETFD)) < 0 )
-    {
-        perror_exit("fctl error");
-    }
-
-    /* set non-block option */
-    opt |= O_NONBLOCK;
-    if ( (opt = fcntl(fd,F_SETFD)) < 0 )
-    {
-        perror_exit("fcntl error");
-    }
-}
@@ -9,11 +9,13 @@
                                   } while(0);
 
 #define   MAXLINE      1024
-#define   LISTENQ      5
 #define   OPENMAX      1000
 #define   INFTIM       -1
 
 #define   EPOLL_SIZE   100
 #define   EPOLL_EVENTS 1000
 
+/* the most connections accepted per wakeup */
+#define   ACCEPT_BATCH     64
+
 #endif  /*TOOL_H*/
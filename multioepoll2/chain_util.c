@@ -0,0 +1,322 @@
+#include  "chain_util.h"
+
+/* chain_segsize: the number of bytes a segment can hold */
+static int chain_segsize(const chain_t *chain)
+{
+    return chain->pool->objsize - sizeof(chain_seg_t);
+}
+
+/* chain_init: initialize an empty chain
+ * @chain: the chain to be initialized
+ * @pool: the pool the segments are taken from
+ *
+ * */
+void chain_init(chain_t *chain, slab_pool_t *pool)
+{
+    chain->head = NULL;
+    chain->tail = NULL;
+    chain->nsegs = 0;
+    chain->ndata = 0;
+    chain->pool = pool;
+    chain->pinned = NULL;
+    chain->pinned_tail = NULL;
+    chain->npinned = 0;
+    chain->zc_next = 0;
+    chain->zc_done = 0;
+    chain->zc_ranges = NULL;
+    chain->nranges = 0;
+    chain->maxranges = 0;
+}
+
+/* chain_hasdata: the number of bytes queued
+ * @chain: the chain
+ *
+ * */
+int chain_hasdata(const chain_t *chain)
+{
+    return chain->ndata;
+}
+
+/* chain_append: copy @n bytes of @data to the end of the chain, filling the
+ * last segment before adding new ones
+ * @chain: the chain
+ * @data: the data
+ * @n: the number of bytes
+ *
+ * */
+void chain_append(chain_t *chain, const char *data, int n)
+{
+    int segsize = chain_segsize(chain);
+
+    while (n > 0)
+    {
+        chain_seg_t *seg = chain->tail;
+        if (seg == NULL || seg->end == segsize)
+        {
+            seg = slab_alloc(chain->pool);
+            seg->next = NULL;
+            seg->start = 0;
+            seg->end = 0;
+            seg->zcref = 0;
+
+            if (chain->tail)
+            {
+                chain->tail->next = seg;
+            }
+            else
+            {
+                chain->head = seg;
+            }
+            chain->tail = seg;
+            chain->nsegs++;
+        }
+
+        int len = segsize - seg->end;
+        if (len > n)
+        {
+            len = n;
+        }
+        memcpy(seg->data + seg->end,data,len);
+        seg->end += len;
+        chain->ndata += len;
+        data += len;
+        n -= len;
+    }
+}
+
+/* chain_iov: describe up to IOV_MAX segments from the head in @iov, return
+ * the number of them */
+static int chain_iov(const chain_t *chain, struct iovec *iov)
+{
+    chain_seg_t *seg;
+    int nseg = 0;
+
+    for (seg = chain->head; seg && nseg < IOV_MAX; seg = seg->next)
+    {
+        iov[nseg].iov_base = seg->data + seg->start;
+        iov[nseg].iov_len = seg->end - seg->start;
+        nseg++;
+    }
+    return nseg;
+}
+
+/* chain_consume: drop @n sent bytes from the head of the chain */
+static void chain_consume(chain_t *chain, int n)
+{
+    chain->ndata -= n;
+
+    while (n > 0)
+    {
+        chain_seg_t *seg = chain->head;
+        int len = seg->end - seg->start;
+
+        if (n < len)
+        {
+            seg->start += n;
+            return;
+        }
+
+        n -= len;
+        chain->head = seg->next;
+        if (chain->head == NULL)
+        {
+            chain->tail = NULL;
+        }
+        chain->nsegs--;
+
+        /* the kernel may still be reading from it */
+        if (seg->zcref)
+        {
+            seg->next = NULL;
+            if (chain->pinned_tail)
+            {
+                chain->pinned_tail->next = seg;
+            }
+            else
+            {
+                chain->pinned = seg;
+            }
+            chain->pinned_tail = seg;
+            chain->npinned++;
+        }
+        else
+        {
+            slab_free(chain->pool,seg);
+        }
+    }
+}
+
+/* chain_writefd: write the chain to @fd, up to IOV_MAX segments in one
+ * writev, the sent segments go back to the pool
+ * @chain: the chain
+ * @fd: the fd written to
+ *
+ * return what writev returns, 0 if the chain is empty
+ *
+ * */
+int chain_writefd(chain_t *chain, int fd)
+{
+    struct iovec iov[IOV_MAX];
+    int nseg = chain_iov(chain,iov);
+
+    if (nseg == 0)
+    {
+        return 0;
+    }
+
+    int nwrite = writev(fd,iov,nseg);
+    if (nwrite > 0)
+    {
+        chain_consume(chain,nwrite);
+    }
+    return nwrite;
+}
+
+/* chain_sendzc: send the chain to @fd like chain_writefd but with
+ * MSG_ZEROCOPY, the kernel sends from the segments themselves, so the sent
+ * ones are pinned until chain_zc_complete reports the send done
+ * @chain: the chain
+ * @fd: the socket written to, with SO_ZEROCOPY set
+ *
+ * return what sendmsg returns, 0 if the chain is empty
+ *
+ * */
+int chain_sendzc(chain_t *chain, int fd)
+{
+    struct iovec iov[IOV_MAX];
+    struct msghdr msg;
+    int nseg = chain_iov(chain,iov);
+
+    if (nseg == 0)
+    {
+        return 0;
+    }
+
+    memset(&msg,0,sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = nseg;
+
+    int nsend = sendmsg(fd,&msg,MSG_ZEROCOPY);
+    if (nsend < 0)
+    {
+        /* out of memory to pin the pages, copy this time */
+        if (errno == ENOBUFS)
+        {
+            return chain_writefd(chain,fd);
+        }
+        return nsend;
+    }
+
+    /* every successful call gets the next id, mark the segments it sent
+     * from before they are consumed */
+    unsigned id = chain->zc_next++;
+    chain_seg_t *seg;
+    int n = nsend;
+    for (seg = chain->head; seg && n > 0; seg = seg->next)
+    {
+        seg->zcid = id;
+        seg->zcref = 1;
+        n -= seg->end - seg->start;
+    }
+
+    chain_consume(chain,nsend);
+    return nsend;
+}
+
+/* chain_haspinned: the number of sent segments waiting for their zero copy
+ * completion
+ * @chain: the chain
+ *
+ * */
+int chain_haspinned(const chain_t *chain)
+{
+    return chain->npinned;
+}
+
+/* chain_zc_complete: the zero copy sends @lo to @hi have completed, the
+ * pinned segments no send is reading from any more go back to the pool
+ * @chain: the chain
+ * @lo: the first completed send
+ * @hi: the last completed send
+ *
+ * */
+void chain_zc_complete(chain_t *chain, unsigned lo, unsigned hi)
+{
+    int i;
+
+    /* completions may come out of order, keep the ones ahead of zc_done
+     * until the gap before them is filled */
+    if (lo != chain->zc_done)
+    {
+        if (chain->nranges == chain->maxranges)
+        {
+            chain->maxranges = chain->maxranges ? chain->maxranges * 2 : 8;
+            chain->zc_ranges = realloc(chain->zc_ranges,chain->maxranges * sizeof(unsigned[2]));
+            assert(chain->zc_ranges);
+        }
+        chain->zc_ranges[chain->nranges][0] = lo;
+        chain->zc_ranges[chain->nranges][1] = hi;
+        chain->nranges++;
+        return;
+    }
+
+    chain->zc_done = hi + 1;
+    for (i = 0; i < chain->nranges; )
+    {
+        if (chain->zc_ranges[i][0] == chain->zc_done)
+        {
+            chain->zc_done = chain->zc_ranges[i][1] + 1;
+            chain->zc_ranges[i][0] = chain->zc_ranges[chain->nranges - 1][0];
+            chain->zc_ranges[i][1] = chain->zc_ranges[chain->nranges - 1][1];
+            chain->nranges--;
+            i = 0;
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    /* the pinned segments are in send order, the ids wrap around */
+    while (chain->pinned && (int)(chain->pinned->zcid - chain->zc_done) < 0)
+    {
+        chain_seg_t *seg = chain->pinned;
+        chain->pinned = seg->next;
+        if (chain->pinned == NULL)
+        {
+            chain->pinned_tail = NULL;
+        }
+        chain->npinned--;
+        slab_free(chain->pool,seg);
+    }
+}
+
+/* chain_destroy: drop everything queued
+ * @chain: the chain
+ *
+ * */
+void chain_destroy(chain_t *chain)
+{
+    while (chain->head)
+    {
+        chain_seg_t *seg = chain->head;
+        chain->head = seg->next;
+        slab_free(chain->pool,seg);
+    }
+    chain->tail = NULL;
+    chain->nsegs = 0;
+    chain->ndata = 0;
+
+    while (chain->pinned)
+    {
+        chain_seg_t *seg = chain->pinned;
+        chain->pinned = seg->next;
+        slab_free(chain->pool,seg);
+    }
+    chain->pinned_tail = NULL;
+    chain->npinned = 0;
+
+    free(chain->zc_ranges);
+    chain->zc_ranges = NULL;
+    chain->nranges = chain->maxranges = 0;
+}
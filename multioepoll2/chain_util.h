@@ -0,0 +1,90 @@
+#ifndef  CHAIN_UTIL_H
+#define  CHAIN_UTIL_H
+
+#define   _GNU_SOURCE
+
+#include  <stdlib.h>
+#include  <string.h>
+#include  <limits.h>
+#include  <errno.h>
+#include  <sys/uio.h>
+#include  <sys/socket.h>
+
+#include  "slab_util.h"
+
+/* chain_seg: one segment of a chain, it fills one block of the pool
+ * .next: the next segment
+ * .start: the offset of the first byte not sent yet
+ * .end: the offset past the last byte
+ * .zcid: the last zero copy send the segment took part in
+ * .zcref: set if a zero copy send took part of the segment
+ * .data: the bytes, up to the block size minus this header
+ *
+ * */
+typedef struct chain_seg
+{
+    struct chain_seg *next;
+    int start;
+    int end;
+    unsigned zcid;
+    int zcref;
+    char data[];
+}chain_seg_t;
+
+/* buf_chain: an output queue of chained segments
+ * .head/.tail: the first and last segment
+ * .nsegs: the number of segments
+ * .ndata: the number of bytes queued
+ * .pool: the pool the segments are taken from
+ * .pinned/.pinned_tail/.npinned: the sent segments the kernel may still be
+ * reading from, they are kept until their zero copy sends complete
+ * .zc_next: the id of the next zero copy send
+ * .zc_done: every send before this id has completed
+ * .zc_ranges/.nranges/.maxranges: the completions reported ahead of zc_done
+ *
+ * pieces appended one after another (headers, payload, trailer, or many
+ * small messages for the same peer) are all flushed by a single writev
+ *
+ * */
+typedef struct buf_chain
+{
+    chain_seg_t *head;
+    chain_seg_t *tail;
+    int nsegs;
+    int ndata;
+    slab_pool_t *pool;
+    chain_seg_t *pinned;
+    chain_seg_t *pinned_tail;
+    int npinned;
+    unsigned zc_next;
+    unsigned zc_done;
+    unsigned (*zc_ranges)[2];
+    int nranges;
+    int maxranges;
+}chain_t;
+
+/* initialize an empty chain taking its segments from @pool */
+void chain_init(chain_t *chain, slab_pool_t *pool);
+
+/* the number of bytes queued */
+int chain_hasdata(const chain_t *chain);
+
+/* copy @n bytes of @data to the end of the chain */
+void chain_append(chain_t *chain, const char *data, int n);
+
+/* write as much of the chain as possible with one writev */
+int chain_writefd(chain_t *chain, int fd);
+
+/* send as much of the chain as possible with one MSG_ZEROCOPY sendmsg */
+int chain_sendzc(chain_t *chain, int fd);
+
+/* the number of sent segments waiting for their zero copy completion */
+int chain_haspinned(const chain_t *chain);
+
+/* the zero copy sends @lo to @hi have completed */
+void chain_zc_complete(chain_t *chain, unsigned lo, unsigned hi);
+
+/* give all segments back to the pool */
+void chain_destroy(chain_t *chain);
+
+#endif  /*CHAIN_UTIL_H*/
@@ -0,0 +1,226 @@
+#include  "conn_util.h"
+
+/* the initial number of slots in the connection table */
+#define   CONN_TABLE_SIZE    1024
+
+/* the number of connections preallocated per table, the pools grow by the
+ * same amount when they run out */
+#define   CONN_PREALLOC      512
+
+/* the most idle pipes kept per table */
+#define   PIPE_POOL_MAX      4096
+
+/* conn_table_init: initialize an empty connection table
+ * @table: the table to be initialized
+ *
+ * */
+void conn_table_init(conn_table_t *table)
+{
+    table->size = CONN_TABLE_SIZE;
+    table->conns = calloc(table->size,sizeof(conn_t *));
+    assert(table->conns);
+
+    /* preallocate the connections, their input buffers and the segments of
+     * their output queues */
+    slab_init(&table->conn_pool,sizeof(conn_t),CONN_PREALLOC);
+    slab_init(&table->buf_pool,BUFSIZE,2 * CONN_PREALLOC);
+
+    table->pipes = NULL;
+    table->npipes = table->maxpipes = table->minpipes = 0;
+    table->counters = NULL;
+
+    /* an empty wheel jumps to the loop time on its first advance */
+    wheel_init(&table->wheel,0);
+
+    table->maxdirty = CONN_TABLE_SIZE;
+    table->dirty = malloc(table->maxdirty * sizeof(int));
+    assert(table->dirty);
+    table->ndirty = 0;
+}
+
+/* conn_new: create the connection of @fd, the table grows to hold any fd
+ * @table: the table the connection is added into
+ * @fd: the connected socket
+ *
+ * */
+conn_t *conn_new(conn_table_t *table, int fd)
+{
+    if (fd >= table->size)
+    {
+        int size = table->size;
+        while (fd >= size)
+        {
+            size *= 2;
+        }
+
+        table->conns = realloc(table->conns,size * sizeof(conn_t *));
+        assert(table->conns);
+        memset(table->conns + table->size,0,(size - table->size) * sizeof(conn_t *));
+        table->size = size;
+    }
+
+    conn_t *conn = slab_alloc(&table->conn_pool);
+    memset(conn,0,sizeof(conn_t));
+    conn->fd = fd;
+    conn->pipefd[0] = conn->pipefd[1] = -1;
+    conn->counters = table->counters;
+    conn->table = table;
+    wheel_timer_init(&conn->timer);
+    conn->last_read = conn->last_write = table->wheel.now;
+    buffer_init_pool(&conn->inbuf,&table->buf_pool);
+    chain_init(&conn->outq,&table->buf_pool);
+
+    table->conns[fd] = conn;
+    return conn;
+}
+
+/* conn_get: look up the connection of @fd
+ * @table: the table to search
+ * @fd: the connected socket
+ *
+ * */
+conn_t *conn_get(const conn_table_t *table, int fd)
+{
+    if (fd < 0 || fd >= table->size)
+    {
+        return NULL;
+    }
+    return table->conns[fd];
+}
+
+/* conn_free: remove @conn from the table and release it
+ * @table: the table the connection belongs to
+ * @conn: the connection to be released
+ *
+ * */
+void conn_free(conn_table_t *table, conn_t *conn)
+{
+    table->conns[conn->fd] = NULL;
+    wheel_del(&table->wheel,&conn->timer);
+    conn_pipe_put(table,conn);
+    buffer_destroy(&conn->inbuf);
+    chain_destroy(&conn->outq);
+    slab_free(&table->conn_pool,conn);
+}
+
+/* conn_send: queue data for the connection, any connection of the loop, the
+ * flush pass after the events writes it out with whatever else is queued
+ * by then
+ * @conn: the connection
+ * @data: the data, copied into the output queue
+ * @n: the bytes of data
+ *
+ * */
+void conn_send(conn_t *conn, const char *data, int n)
+{
+    chain_append(&conn->outq,data,n);
+    conn_dirty(conn);
+}
+
+/* conn_dirty: queue the connection for the next flush pass, the fd is kept
+ * instead of the connection, so one closed before the pass is looked up as
+ * gone
+ * @conn: the connection
+ *
+ * */
+void conn_dirty(conn_t *conn)
+{
+    conn_table_t *table = conn->table;
+
+    if (conn->dirty)
+    {
+        return;
+    }
+
+    if (table->ndirty == table->maxdirty)
+    {
+        table->maxdirty *= 2;
+        table->dirty = realloc(table->dirty,table->maxdirty * sizeof(int));
+        assert(table->dirty);
+    }
+    table->dirty[table->ndirty++] = conn->fd;
+    conn->dirty = 1;
+}
+
+/* conn_pipe_get: attach a pipe to @conn, taken from the idle pipes of the
+ * table if there is any, so pipes are not created per connection
+ * @table: the table the connection belongs to
+ * @conn: the connection
+ *
+ * return 0, -1 if no pipe can be created
+ *
+ * */
+int conn_pipe_get(conn_table_t *table, conn_t *conn)
+{
+    if (table->npipes > 0)
+    {
+        table->npipes--;
+        conn->pipefd[0] = table->pipes[table->npipes][0];
+        conn->pipefd[1] = table->pipes[table->npipes][1];
+        if (table->npipes < table->minpipes)
+        {
+            table->minpipes = table->npipes;
+        }
+    }
+    else if (pipe2(conn->pipefd,O_NONBLOCK | O_CLOEXEC) < 0)
+    {
+        conn->pipefd[0] = conn->pipefd[1] = -1;
+        return -1;
+    }
+
+    conn->inpipe = 0;
+    return 0;
+}
+
+/* conn_pipe_put: detach the pipe of @conn, an empty pipe is kept for the
+ * next connection, one still holding data is closed
+ * @table: the table the connection belongs to
+ * @conn: the connection
+ *
+ * */
+void conn_pipe_put(conn_table_t *table, conn_t *conn)
+{
+    if (conn->pipefd[0] < 0)
+    {
+        return;
+    }
+
+    if (conn->inpipe == 0 && table->npipes < PIPE_POOL_MAX)
+    {
+        if (table->npipes == table->maxpipes)
+        {
+            table->maxpipes = table->maxpipes ? table->maxpipes * 2 : 64;
+            table->pipes = realloc(table->pipes,table->maxpipes * sizeof(int[2]));
+            assert(table->pipes);
+        }
+        table->pipes[table->npipes][0] = conn->pipefd[0];
+        table->pipes[table->npipes][1] = conn->pipefd[1];
+        table->npipes++;
+    }
+    else
+    {
+        close(conn->pipefd[0]);
+        close(conn->pipefd[1]);
+    }
+
+    conn->pipefd[0] = conn->pipefd[1] = -1;
+    conn->inpipe = 0;
+}
+
+/* conn_pipe_trim: close the kept pipes that were never taken since the last
+ * trim, the pool shrinks back to what the connections needed at the peak
+ * of the period instead of holding the peak of a past burst forever
+ * @table: the connection table
+ *
+ * */
+void conn_pipe_trim(conn_table_t *table)
+{
+    while (table->minpipes > 0)
+    {
+        table->npipes--;
+        table->minpipes--;
+        close(table->pipes[table->npipes][0]);
+        close(table->pipes[table->npipes][1]);
+    }
+    table->minpipes = table->npipes;
+}
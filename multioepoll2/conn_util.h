@@ -0,0 +1,125 @@
+#ifndef  CONN_UTIL_H
+#define  CONN_UTIL_H
+
+#define   _GNU_SOURCE
+
+#include  <stdlib.h>
+#include  <assert.h>
+#include  <string.h>
+#include  <unistd.h>
+#include  <fcntl.h>
+
+#include  "buffer_util.h"
+#include  "slab_util.h"
+#include  "chain_util.h"
+#include  "wheel_util.h"
+
+struct loop_counters;
+struct conn_table;
+
+/* connection: the state kept for each connected client
+ * .fd: the connected socket
+ * .readable: the socket may have more data, no EAGAIN seen since EPOLLIN
+ * .writable: the socket send buffer has space, no EAGAIN seen since EPOLLOUT
+ * .eof: "FIN" has been read from the client
+ * .inbuf: the data read from the socket
+ * .outq: the data waiting to be written to the socket
+ * .pipefd: the pipe the data is spliced through in splice mode, -1 if none
+ * .inpipe: the number of bytes in the pipe
+ * .zerocopy: large writes are sent with MSG_ZEROCOPY
+ * .closing: closed by the server, the socket is kept until the kernel has
+ * completed the zero copy sends
+ * .accepted: when the connection was accepted, 0 once its first byte came
+ * .counters: the counters of the loop serving the connection
+ * .timer: the timer of the earliest timeout that applies to the connection
+ * .last_read: the last tick data came in
+ * .last_write: the last tick data went out, or the output started waiting
+ * .data: the state the protocol keeps for the connection
+ * .table: the table the connection belongs to
+ * .dirty: queued on the dirty list of the table, to be flushed
+ *
+ * */
+typedef struct connection
+{
+    int fd;
+    int readable;
+    int writable;
+    int eof;
+    buffer_t inbuf;
+    chain_t outq;
+    int pipefd[2];
+    int inpipe;
+    int zerocopy;
+    int closing;
+    long long accepted;
+    struct loop_counters *counters;
+    wheel_timer_t timer;
+    long long last_read;
+    long long last_write;
+    void *data;
+    struct conn_table *table;
+    int dirty;
+}conn_t;
+
+/* conn_table: the connections indexed by their fd
+ * .conns: the connection of each fd, NULL if the fd is not connected
+ * .size: the number of slots in .conns
+ * .conn_pool: the pool the connections are taken from
+ * .buf_pool: the pool the connection buffers are taken from
+ * .pipes/.npipes/.maxpipes: the empty pipes kept for reuse in splice mode
+ * .minpipes: the fewest pipes kept since the last trim
+ * .counters: the counters of the loop owning the table
+ * .wheel: the timers of the connections, its tick is the loop time in ms
+ * .dirty/.ndirty/.maxdirty: the fds of the connections with output queued
+ * since the last flush pass, a connection is on it once
+ *
+ * each reactor owns its table, so the pools are only touched by one thread
+ * and accepting or closing a connection never calls malloc or free
+ *
+ * */
+typedef struct conn_table
+{
+    conn_t **conns;
+    int size;
+    slab_pool_t conn_pool;
+    slab_pool_t buf_pool;
+    int (*pipes)[2];
+    int npipes;
+    int maxpipes;
+    int minpipes;
+    struct loop_counters *counters;
+    wheel_t wheel;
+    int *dirty;
+    int ndirty;
+    int maxdirty;
+}conn_table_t;
+
+/* initialize an empty connection table */
+void conn_table_init(conn_table_t *table);
+
+/* create the connection of @fd in the table */
+conn_t *conn_new(conn_table_t *table, int fd);
+
+/* look up the connection of @fd, NULL if there is none */
+conn_t *conn_get(const conn_table_t *table, int fd);
+
+/* remove the connection from the table and release it */
+void conn_free(conn_table_t *table, conn_t *conn);
+
+/* queue @n bytes of @data to be sent to the connection */
+void conn_send(conn_t *conn, const char *data, int n);
+
+/* put the connection on the dirty list of its table */
+void conn_dirty(conn_t *conn);
+
+/* attach a pipe to the connection, reusing an idle one if there is any */
+int conn_pipe_get(conn_table_t *table, conn_t *conn);
+
+/* detach the pipe of the connection, keeping it for reuse if it is empty */
+void conn_pipe_put(conn_table_t *table, conn_t *conn);
+
+/* close the kept pipes that none of the connections needed since the last
+ * trim */
+void conn_pipe_trim(conn_table_t *table);
+
+#endif  /*CONN_UTIL_H*/
@@ -0,0 +1,152 @@
+#include  "frame_util.h"
+
+#include  <string.h>
+
+/* frame_header_find: look a header format up by its name
+ * @name: "2", "4" or "varint"
+ *
+ * return FRAME_LEN16, FRAME_LEN32 or FRAME_VARINT, -1 for any other name
+ *
+ * */
+int frame_header_find(const char *name)
+{
+    if (strcmp(name,"2") == 0)
+    {
+        return FRAME_LEN16;
+    }
+    if (strcmp(name,"4") == 0)
+    {
+        return FRAME_LEN32;
+    }
+    if (strcmp(name,"varint") == 0)
+    {
+        return FRAME_VARINT;
+    }
+    return -1;
+}
+
+/* frame_varint: decode the varint at the start of @data
+ * @data: the input
+ * @len: the bytes of input
+ * @value: set to the value decoded
+ *
+ * return the bytes of the varint, 0 if it is not complete yet, -1 if it
+ * does not fit in 32 bits
+ *
+ * */
+static int frame_varint(const unsigned char *data, int len, uint32_t *value)
+{
+    uint64_t v = 0;
+    int i;
+
+    for (i = 0; i < len && i < FRAME_HDRMAX; ++i)
+    {
+        v |= (uint64_t)(data[i] & 0x7f) << (7 * i);
+        if ((data[i] & 0x80) == 0)
+        {
+            if (v > UINT32_MAX)
+            {
+                return -1;
+            }
+            *value = v;
+            return i + 1;
+        }
+    }
+
+    return i == FRAME_HDRMAX ? -1 : 0;
+}
+
+/* frame_parse: cut the frame at the start of @data, which may hold only a
+ * part of it when it came in over several reads. the length is checked as
+ * soon as the header is in, so a peer announcing a huge frame is turned
+ * down before the buffer grows for it
+ * @codec: the header format and the largest payload
+ * @data: the input
+ * @len: the bytes of input
+ * @frame: set to the view of the frame when it is complete
+ *
+ * return 1 if a complete frame is at the start of @data, 0 if more data is
+ * needed, -1 if the header is malformed or announces more than .maxsize
+ *
+ * */
+int frame_parse(const frame_codec_t *codec, const char *data, int len, frame_t *frame)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    uint32_t plen;
+    int hlen;
+
+    switch (codec->header)
+    {
+        case FRAME_LEN16:
+            if (len < 2)
+            {
+                return 0;
+            }
+            plen = ((uint32_t)p[0] << 8) | p[1];
+            hlen = 2;
+            break;
+        case FRAME_LEN32:
+            if (len < 4)
+            {
+                return 0;
+            }
+            plen = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+            hlen = 4;
+            break;
+        default:
+            if ( (hlen = frame_varint(p,len,&plen)) <= 0 )
+            {
+                return hlen;
+            }
+    }
+
+    if (plen > (uint32_t)codec->maxsize)
+    {
+        return -1;
+    }
+    if ((uint32_t)(len - hlen) < plen)
+    {
+        return 0;
+    }
+
+    frame->data = data + hlen;
+    frame->len = plen;
+    frame->size = hlen + plen;
+    return 1;
+}
+
+/* frame_header: encode the header of a frame
+ * @codec: the header format
+ * @hdr: the header is written there, FRAME_HDRMAX bytes at least
+ * @len: the bytes of payload the frame carries
+ *
+ * return the bytes of the header
+ *
+ * */
+int frame_header(const frame_codec_t *codec, char *hdr, uint32_t len)
+{
+    unsigned char *p = (unsigned char *)hdr;
+    int n = 0;
+
+    switch (codec->header)
+    {
+        case FRAME_LEN16:
+            p[0] = len >> 8;
+            p[1] = len;
+            return 2;
+        case FRAME_LEN32:
+            p[0] = len >> 24;
+            p[1] = len >> 16;
+            p[2] = len >> 8;
+            p[3] = len;
+            return 4;
+        default:
+            while (len >= 0x80)
+            {
+                p[n++] = (len & 0x7f) | 0x80;
+                len >>= 7;
+            }
+            p[n++] = len;
+            return n;
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef  FRAME_UTIL_H
+#define  FRAME_UTIL_H
+
+#include  <stdint.h>
+
+/* the formats of the length header in front of every frame, the length
+ * counts the payload only
+ * FRAME_LEN16: 2 bytes, big endian
+ * FRAME_LEN32: 4 bytes, big endian
+ * FRAME_VARINT: 1 to 5 bytes, 7 bits each, the least significant first,
+ * the top bit set on all but the last byte
+ * */
+#define   FRAME_LEN16      2
+#define   FRAME_LEN32      4
+#define   FRAME_VARINT     0
+
+/* the longest header of any format */
+#define   FRAME_HDRMAX     5
+
+/* the default largest payload a frame may carry */
+#define   FRAME_MAXSIZE    64*1024
+
+/* frame: a complete frame found in the input, a view into it, nothing is
+ * copied
+ * .data: the first byte of the payload
+ * .len: the bytes of payload
+ * .size: the bytes of the whole frame, header included
+ *
+ * */
+typedef struct frame
+{
+    const char *data;
+    int len;
+    int size;
+}frame_t;
+
+/* frame_codec: how the frames of a connection are cut
+ * .header: FRAME_LEN16, FRAME_LEN32 or FRAME_VARINT
+ * .maxsize: the largest payload accepted, a larger one is an error before
+ * any of it is buffered
+ *
+ * */
+typedef struct frame_codec
+{
+    int header;
+    int maxsize;
+}frame_codec_t;
+
+/* look the header format up by its name, 2, 4 or varint, -1 if unknown */
+int frame_header_find(const char *name);
+
+/* cut the frame at the start of @data, return 1 if it is complete, 0 if
+ * more data is needed, -1 if it is malformed or too large */
+int frame_parse(const frame_codec_t *codec, const char *data, int len, frame_t *frame);
+
+/* write the header of a @len bytes payload into @hdr, at least
+ * FRAME_HDRMAX bytes, return its size */
+int frame_header(const frame_codec_t *codec, char *hdr, uint32_t len);
+
+#endif  /*FRAME_UTIL_H*/
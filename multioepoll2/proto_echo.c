@@ -0,0 +1,26 @@
+#include  "proto_util.h"
+
+/* echo_data: send back whatever came in, as it came in
+ * @conn: the connection
+ * @data: the input
+ * @len: the bytes of input
+ *
+ * return @len, all of it is consumed
+ *
+ * */
+static int echo_data(conn_t *conn, const char *data, int len)
+{
+    conn_send(conn,data,len);
+    return len;
+}
+
+/* the echo keeps no state, and -s lets it bypass on_data altogether by
+ * splicing the input back in the kernel */
+const proto_t proto_echo =
+{
+    "echo",
+    NULL,
+    echo_data,
+    NULL,
+    NULL,
+};
@@ -0,0 +1,64 @@
+#include  "sock_util.h"
+
+/* frame_accept: let the input buffer of @conn grow enough to hold the
+ * largest frame with its header, and no further
+ * @conn: the connection
+ *
+ * return 0
+ *
+ * */
+static int frame_accept(conn_t *conn)
+{
+    unsigned int maxsize = conn->inbuf.maxsize;
+
+    while (maxsize < (unsigned int)server_conf.frame.maxsize + FRAME_HDRMAX)
+    {
+        maxsize *= 2;
+    }
+    conn->inbuf.maxsize = maxsize;
+    return 0;
+}
+
+/* frame_data: echo every complete frame of the input, the payload is sent
+ * from the view of the input buffer with a header of its own, a frame not
+ * complete yet is left for the next read
+ * @conn: the connection
+ * @data: the input
+ * @len: the bytes of input
+ *
+ * return the bytes of the complete frames, -1 for a malformed or too large
+ * frame
+ *
+ * */
+static int frame_data(conn_t *conn, const char *data, int len)
+{
+    frame_t frame;
+    char hdr[FRAME_HDRMAX];
+    int consumed = 0, n;
+
+    while ( (n = frame_parse(&server_conf.frame,data + consumed,len - consumed,&frame)) > 0 )
+    {
+        conn_send(conn,hdr,frame_header(&server_conf.frame,hdr,frame.len));
+        conn_send(conn,frame.data,frame.len);
+        consumed += frame.size;
+    }
+
+    if (n < 0)
+    {
+        log_warn("frame error: fd %d sent a malformed frame or one over %d bytes",
+                 conn->fd,server_conf.frame.maxsize);
+        return -1;
+    }
+    return consumed;
+}
+
+/* the framed echo, a starting point for the length-prefixed protocols: the
+ * frames come in as views, so a protocol only replaces frame_data */
+const proto_t proto_frame =
+{
+    "frame",
+    frame_accept,
+    frame_data,
+    NULL,
+    NULL,
+};
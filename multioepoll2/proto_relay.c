@@ -0,0 +1,99 @@
+#include  "sock_util.h"
+
+#include  <stdint.h>
+
+/* the connections of the relay run by this thread, each reactor relays
+ * among the clients it accepted, as it owns their output queues. the index
+ * of a connection in .members is kept in its .data */
+static __thread conn_t **members;
+static __thread int nmembers;
+static __thread int maxmembers;
+
+/* relay_accept: size the input buffer for the frames and join the relay
+ * @conn: the connection
+ *
+ * return 0
+ *
+ * */
+static int relay_accept(conn_t *conn)
+{
+    proto_frame.on_accept(conn);
+
+    if (nmembers == maxmembers)
+    {
+        maxmembers = maxmembers ? maxmembers * 2 : 1024;
+        members = realloc(members,maxmembers * sizeof(conn_t *));
+        assert(members);
+    }
+    conn->data = (void *)(intptr_t)nmembers;
+    members[nmembers++] = conn;
+    return 0;
+}
+
+/* relay_data: send every complete frame to all the other members, the
+ * frames of one wakeup pile up in their output queues and each of them
+ * gets them with one writev in the flush pass
+ * @conn: the sender
+ * @data: the input
+ * @len: the bytes of input
+ *
+ * return the bytes of the complete frames, -1 for a malformed or too large
+ * frame
+ *
+ * */
+static int relay_data(conn_t *conn, const char *data, int len)
+{
+    frame_t frame;
+    char hdr[FRAME_HDRMAX];
+    int consumed = 0, n, i, hlen;
+
+    while ( (n = frame_parse(&server_conf.frame,data + consumed,len - consumed,&frame)) > 0 )
+    {
+        hlen = frame_header(&server_conf.frame,hdr,frame.len);
+        for (i = 0; i < nmembers; ++i)
+        {
+            conn_t *peer = members[i];
+
+            /* a member not reading misses the frames instead of making
+             * everybody's memory grow */
+            if (peer == conn || chain_hasdata(&peer->outq) >= CHAIN_HIGHWAT)
+            {
+                continue;
+            }
+            conn_send(peer,hdr,hlen);
+            conn_send(peer,frame.data,frame.len);
+        }
+        consumed += frame.size;
+    }
+
+    if (n < 0)
+    {
+        log_warn("frame error: fd %d sent a malformed frame or one over %d bytes",
+                 conn->fd,server_conf.frame.maxsize);
+        return -1;
+    }
+    return consumed;
+}
+
+/* relay_close: leave the relay, the last member takes the place
+ * @conn: the connection
+ *
+ * */
+static void relay_close(conn_t *conn)
+{
+    int i = (int)(intptr_t)conn->data;
+
+    members[i] = members[--nmembers];
+    members[i]->data = (void *)(intptr_t)i;
+}
+
+/* the relay, a broadcast of length-prefixed frames: what one client sends
+ * goes to every other client of the same reactor, never back to itself */
+const proto_t proto_relay =
+{
+    "relay",
+    relay_accept,
+    relay_data,
+    NULL,
+    relay_close,
+};
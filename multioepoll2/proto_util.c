@@ -0,0 +1,53 @@
+#include  "proto_util.h"
+
+/* the protocols proto_find knows, in the order of the usage line */
+static const proto_t *protos[] =
+{
+    &proto_echo,
+    &proto_frame,
+    &proto_relay,
+};
+
+#define   PROTO_NPROTOS    (int)(sizeof(protos) / sizeof(protos[0]))
+
+/* proto_find: look a protocol up by its name
+ * @name: the name given to -P
+ *
+ * return the protocol, NULL if there is none called @name
+ *
+ * */
+const proto_t *proto_find(const char *name)
+{
+    int i;
+
+    for (i = 0; i < PROTO_NPROTOS; ++i)
+    {
+        if (strcmp(protos[i]->name,name) == 0)
+        {
+            return protos[i];
+        }
+    }
+    return NULL;
+}
+
+/* proto_names: the names of the protocols, e.g. "echo|relay"
+ *
+ * */
+const char *proto_names(void)
+{
+    static char names[64];
+    int i;
+
+    if (names[0] == '\0')
+    {
+        for (i = 0; i < PROTO_NPROTOS; ++i)
+        {
+            if (i > 0)
+            {
+                strcat(names,"|");
+            }
+            strcat(names,protos[i]->name);
+        }
+    }
+    return names;
+}
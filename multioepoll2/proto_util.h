@@ -0,0 +1,42 @@
+#ifndef  PROTO_UTIL_H
+#define  PROTO_UTIL_H
+
+#include  "conn_util.h"
+
+/* proto: the application protocol the reactors run on every connection,
+ * the loop does the socket io and calls it back, so a new protocol never
+ * touches the loop
+ * .name: the name the protocol is looked up by
+ * .on_accept: a connection was accepted, return -1 to close it at once
+ * .on_data: @len bytes of input at @data, a view into the input buffer of
+ * the connection, valid until the call returns. return the bytes consumed,
+ * the rest is passed again with more data behind it, -1 to close the
+ * connection
+ * .on_writable: the output queue has been written out, more may be queued
+ * .on_close: the connection is being closed, release what the protocol
+ * keeps in .data of the connection. it follows every .on_accept, the one
+ * that turned the connection down included
+ * all but .on_data may be NULL
+ *
+ * */
+typedef struct proto
+{
+    const char *name;
+    int (*on_accept)(conn_t *conn);
+    int (*on_data)(conn_t *conn, const char *data, int len);
+    void (*on_writable)(conn_t *conn);
+    void (*on_close)(conn_t *conn);
+}proto_t;
+
+/* the protocols */
+extern const proto_t proto_echo;
+extern const proto_t proto_frame;
+extern const proto_t proto_relay;
+
+/* the protocol called @name, NULL if there is none */
+const proto_t *proto_find(const char *name);
+
+/* the names of the protocols, separated by '|', for the usage line */
+const char *proto_names(void);
+
+#endif  /*PROTO_UTIL_H*/
@@ -0,0 +1,318 @@
+#include  "reactor_util.h"
+
+/* online_cpus: the number of online cpus
+ *
+ * */
+int online_cpus(void)
+{
+    long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return ncpus > 0 ? (int)ncpus : 1;
+}
+
+/* reactor_main: the thread body of a reactor, each reactor binds its own
+ * listen socket to the shared port with SO_REUSEPORT so the kernel spreads
+ * the incoming connections over the reactors, then runs its own epoll loop
+ * with its own connection table
+ * @arg: the reactor
+ *
+ * */
+static void *reactor_main(void *arg)
+{
+    reactor_t *reactor = arg;
+
+    if (reactor->cpu >= 0)
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(reactor->cpu,&cpus);
+        if (pthread_setaffinity_np(pthread_self(),sizeof(cpu_set_t),&cpus) != 0)
+        {
+            log_warn("reactor %d: can not pin to cpu %d",reactor->id,reactor->cpu);
+        }
+    }
+
+    int listenfd = bind_sock(reactor->port,1);
+
+    listen_sock(listenfd,server_conf.backlog);
+
+    handle_connection(listenfd,&reactor->stats);
+
+    return NULL;
+}
+
+/* the counters exported, in the order of loop_counters_t */
+static const struct
+{
+    const char *name;
+    const char *help;
+    size_t offset;
+}counter_info[] =
+{
+    { "echo_accepts_total",        "Connections accepted.",                 offsetof(loop_counters_t,accepts) },
+    { "echo_closes_total",         "Connections closed.",                   offsetof(loop_counters_t,closes) },
+    { "echo_bytes_in_total",       "Bytes read from the clients.",          offsetof(loop_counters_t,bytes_in) },
+    { "echo_bytes_out_total",      "Bytes written to the clients.",         offsetof(loop_counters_t,bytes_out) },
+    { "echo_eagain_read_total",    "Reads that would block.",               offsetof(loop_counters_t,eagain_read) },
+    { "echo_eagain_write_total",   "Writes that would block.",              offsetof(loop_counters_t,eagain_write) },
+    { "echo_partial_writes_total", "Writes that left data queued.",         offsetof(loop_counters_t,partial_writes) },
+    { "echo_writes_total",         "Write system calls, divide the bytes out by them for the bytes per write.",
+                                                                            offsetof(loop_counters_t,writes) },
+    { "echo_flushes_total",        "Connections written by the flush pass after each wakeup.",
+                                                                            offsetof(loop_counters_t,flushes) },
+    { "echo_timeouts_total",       "Connections closed by a timeout.",      offsetof(loop_counters_t,timeouts) },
+    { "echo_epoll_wakeups_total",  "Returns of epoll_wait.",                offsetof(loop_counters_t,wakeups) },
+    { "echo_epoll_events_total",   "Events reported by epoll_wait, divide by the wakeups for the events per wakeup.",
+                                                                            offsetof(loop_counters_t,events) },
+};
+
+#define   COUNTER_NINFO    (int)(sizeof(counter_info) / sizeof(counter_info[0]))
+
+/* read counter @i of @counters */
+static unsigned long long counter_at(const loop_counters_t *counters, int i)
+{
+    const unsigned long long *p = (const void *)((const char *)counters + counter_info[i].offset);
+    return __atomic_load_n(p,__ATOMIC_RELAXED);
+}
+
+/* format_summary: append one timing as a prometheus summary in seconds */
+static int format_summary(char *buf, int size, const char *name, const char *help, const hist_t *hist)
+{
+    return snprintf(buf,size,
+                    "# HELP %s %s\n# TYPE %s summary\n"
+                    "%s{quantile=\"0.5\"} %.9f\n%s{quantile=\"0.99\"} %.9f\n"
+                    "%s{quantile=\"0.999\"} %.9f\n%s{quantile=\"1\"} %.9f\n%s_count %llu\n",
+                    name,help,name,
+                    name,hist_percentile(hist,50) / 1e9,name,hist_percentile(hist,99) / 1e9,
+                    name,hist_percentile(hist,99.9) / 1e9,name,hist_percentile(hist,100) / 1e9,
+                    name,hist_count(hist));
+}
+
+/* format_metrics: write the counters of every reactor and the merged
+ * timings in the prometheus text format, nothing is locked, the counters
+ * are read while the reactors keep updating them
+ * @reactors: the reactors
+ * @nreactors: the number of reactors
+ * @buf: the buffer written to
+ * @size: the size of @buf
+ *
+ * return the length written, the text is cut short if @buf is too small
+ *
+ * */
+static int format_metrics(const reactor_t *reactors, int nreactors, char *buf, int size)
+{
+    static loop_stats_t total;
+    int i, j, len = 0;
+
+#define   APPEND(...)    do { if (len < size) len += snprintf(buf + len,size - len,__VA_ARGS__); } while(0)
+
+    for (j = 0; j < COUNTER_NINFO; ++j)
+    {
+        APPEND("# HELP %s %s\n# TYPE %s counter\n",counter_info[j].name,counter_info[j].help,counter_info[j].name);
+        for (i = 0; i < nreactors; ++i)
+        {
+            APPEND("%s{reactor=\"%d\"} %llu\n",counter_info[j].name,i,counter_at(&reactors[i].stats.counters,j));
+        }
+    }
+
+    APPEND("# HELP echo_active_connections Connections open.\n# TYPE echo_active_connections gauge\n");
+    for (i = 0; i < nreactors; ++i)
+    {
+        const loop_counters_t *counters = &reactors[i].stats.counters;
+        APPEND("echo_active_connections{reactor=\"%d\"} %llu\n",i,
+               counter_get(counters,accepts) - counter_get(counters,closes));
+    }
+
+    hist_init(&total.service);
+    hist_init(&total.wake);
+    hist_init(&total.first_byte);
+    for (i = 0; i < nreactors; ++i)
+    {
+        hist_merge(&total.service,&reactors[i].stats.service);
+        hist_merge(&total.wake,&reactors[i].stats.wake);
+        hist_merge(&total.first_byte,&reactors[i].stats.first_byte);
+    }
+
+    if (len < size)
+    {
+        len += format_summary(buf + len,size - len,"echo_service_seconds",
+                              "Time spent serving one event.",&total.service);
+    }
+    if (len < size)
+    {
+        len += format_summary(buf + len,size - len,"echo_wake_to_dispatch_seconds",
+                              "Time from epoll_wait returning to the event being dispatched.",&total.wake);
+    }
+    if (len < size)
+    {
+        len += format_summary(buf + len,size - len,"echo_accept_to_first_byte_seconds",
+                              "Time from accept to the first byte of a connection.",&total.first_byte);
+    }
+
+#undef    APPEND
+
+    return len < size ? len : size - 1;
+}
+
+/* dump_stats: print the metrics and the buckets of the merged timings
+ * @reactors: the reactors
+ * @nreactors: the number of reactors
+ *
+ * */
+static void dump_stats(const reactor_t *reactors, int nreactors)
+{
+    static char buf[METRICS_SIZE];
+    static hist_t total;
+    int i;
+
+    format_metrics(reactors,nreactors,buf,sizeof(buf));
+    fputs(buf,stderr);
+
+    /* the buckets, so dumps can be merged later */
+    hist_init(&total);
+    for (i = 0; i < nreactors; ++i)
+    {
+        hist_merge(&total,&reactors[i].stats.service);
+    }
+    hist_serialize(&total,buf,sizeof(buf));
+    fprintf(stderr,"# service buckets: %s\n",buf);
+
+    hist_init(&total);
+    for (i = 0; i < nreactors; ++i)
+    {
+        hist_merge(&total,&reactors[i].stats.wake);
+    }
+    hist_serialize(&total,buf,sizeof(buf));
+    fprintf(stderr,"# wake-to-dispatch buckets: %s\n",buf);
+
+    hist_init(&total);
+    for (i = 0; i < nreactors; ++i)
+    {
+        hist_merge(&total,&reactors[i].stats.first_byte);
+    }
+    hist_serialize(&total,buf,sizeof(buf));
+    fprintf(stderr,"# accept-to-first-byte buckets: %s\n",buf);
+}
+
+/* serve_metrics: answer one scrape on the admin port, whatever the request
+ * is, with the metrics over HTTP/1.0, the socket is blocking with a timeout
+ * so a stuck scraper can not hold the main thread
+ * @adminfd: the admin listen socket
+ * @reactors: the reactors
+ * @nreactors: the number of reactors
+ *
+ * */
+static void serve_metrics(int adminfd, const reactor_t *reactors, int nreactors)
+{
+    static char buf[METRICS_SIZE];
+    char req[1024];
+    int connfd;
+
+    if ( (connfd = accept(adminfd,NULL,NULL)) < 0 )
+    {
+        return;
+    }
+
+    struct timeval tv = { 1, 0 };
+    setsockopt(connfd,SOL_SOCKET,SO_RCVTIMEO,&tv,sizeof(tv));
+    setsockopt(connfd,SOL_SOCKET,SO_SNDTIMEO,&tv,sizeof(tv));
+
+    /* only the request line matters, and not even that */
+    if (read(connfd,req,sizeof(req)) > 0)
+    {
+        int len = snprintf(buf,sizeof(buf),"HTTP/1.0 200 OK\r\n"
+                           "Content-Type: text/plain; version=0.0.4\r\n\r\n");
+        len += format_metrics(reactors,nreactors,buf + len,sizeof(buf) - len);
+
+        int off = 0, n;
+        while (off < len && (n = write(connfd,buf + off,len - off)) > 0)
+        {
+            off += n;
+        }
+    }
+
+    close(connfd);
+}
+
+/* start_reactors: run @nreactors event loops, then serve the metrics on the
+ * admin port and dump them on SIGUSR1
+ * @port: the port every reactor listens on
+ * @nreactors: the number of reactors
+ * @pin: pin reactor i to cpu i (modulo the online cpus) if nonzero
+ * @admin_port: the port of the metrics endpoint, 0 for none
+ *
+ * */
+void start_reactors(int port, int nreactors, int pin, int admin_port)
+{
+    int i, ncpus = online_cpus();
+
+    /* the reactors inherit the mask, so only this thread takes SIGUSR1, as
+     * a signalfd, and the loops are never interrupted by it */
+    sigset_t usr1;
+    sigemptyset(&usr1);
+    sigaddset(&usr1,SIGUSR1);
+    pthread_sigmask(SIG_BLOCK,&usr1,NULL);
+
+    /* the counters of each reactor start on their own cache line */
+    reactor_t *reactors = aligned_alloc(64,nreactors * sizeof(reactor_t));
+    assert(reactors);
+    memset(reactors,0,nreactors * sizeof(reactor_t));
+
+    for (i = 0; i < nreactors; ++i)
+    {
+        reactors[i].id = i;
+        reactors[i].port = port;
+        reactors[i].cpu = pin ? i % ncpus : -1;
+        reactors[i].stats.id = i;
+        hist_init(&reactors[i].stats.service);
+        hist_init(&reactors[i].stats.wake);
+        hist_init(&reactors[i].stats.first_byte);
+
+        if ( (errno = pthread_create(&reactors[i].tid,NULL,reactor_main,&reactors[i])) != 0 )
+        {
+            perror_exit("pthread create error");
+        }
+    }
+
+    struct pollfd fds[2];
+    int nfds = 0;
+
+    if ( (fds[nfds].fd = signalfd(-1,&usr1,SFD_CLOEXEC)) < 0 )
+    {
+        perror_exit("signalfd error");
+    }
+    fds[nfds++].events = POLLIN;
+
+    if (admin_port > 0)
+    {
+        fds[nfds].fd = bind_sock(admin_port,0);
+        listen_sock(fds[nfds].fd,LISTENQ);
+        fds[nfds++].events = POLLIN;
+    }
+
+    /* the reactors run until the process exits */
+    while ( 1 )
+    {
+        if (poll(fds,nfds,INFTIM) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror_exit("poll error");
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            struct signalfd_siginfo info;
+            if (read(fds[0].fd,&info,sizeof(info)) == sizeof(info))
+            {
+                dump_stats(reactors,nreactors);
+            }
+        }
+
+        if (nfds > 1 && (fds[1].revents & POLLIN))
+        {
+            serve_metrics(fds[1].fd,reactors,nreactors);
+        }
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef  REACTOR_UTIL_H
+#define  REACTOR_UTIL_H
+
+#include  "sock_util.h"
+
+#include  <pthread.h>
+#include  <sched.h>
+#include  <stddef.h>
+#include  <poll.h>
+#include  <sys/signalfd.h>
+#include  <sys/time.h>
+
+/* the most text one metrics scrape or dump takes */
+#define   METRICS_SIZE     256*1024
+
+/* reactor: one event loop running on its own thread
+ * .id: the index of the reactor
+ * .port: the port its listen socket is bound to
+ * .cpu: the cpu the thread is pinned to, -1 if not pinned
+ * .tid: the thread running the loop
+ * .stats: the timings recorded by the loop
+ *
+ * */
+typedef struct reactor
+{
+    int id;
+    int port;
+    int cpu;
+    pthread_t tid;
+    loop_stats_t stats;
+}reactor_t;
+
+/* the number of online cpus, the default number of reactors */
+int online_cpus(void);
+
+/* run @nreactors event loops on @port, optionally pinned to the cpus, and
+ * expose their metrics on @admin_port and on SIGUSR1 */
+void start_reactors(int port, int nreactors, int pin, int admin_port);
+
+#endif  /*REACTOR_UTIL_H*/
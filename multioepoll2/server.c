@@ -1,4 +1,5 @@
 #include  "sock_util.h"
+#include  "reactor_util.h"
 
 /* howto: 1. run the command: ./server <#port>, which makes the server listen
  *        on the specific #port. and then run: ./client <#ipaddr> <#port>
@@ -12,22 +13,168 @@
  *        3. type the combo keys "ctrl+d" meaning "EOF" by client will cause
  *        the client and server to close the connection.
  *
+ *        4. options: -t <#reactors> runs that many event loops, one per
+ *        thread, each with its own listen socket on the same port (default:
+ *        the number of online cpus). -a pins reactor i to cpu i. -s echoes
+ *        through a pipe per connection with splice(), so the data is never
+ *        copied into the server. -z <#bytes> sends with MSG_ZEROCOPY once
+ *        that many bytes are queued for a client.
+ *        example: ./server -t 4 -a -s 9899
+ *                 ./server -z 65536 9899
+ *
+ *        5. -m <#port> serves the metrics of the server on that port in the
+ *        prometheus text format: the counters of each reactor (accepts,
+ *        active connections, bytes, EAGAINs, partial writes, write calls,
+ *        epoll wakeups and events) and the timings (the service time of each event, the
+ *        time from epoll_wait waking up to the event being dispatched, and
+ *        the time from accept to the first byte of a client).
+ *        kill -USR1 <#pid> prints the same to stderr, with the histogram
+ *        buckets of the timings.
+ *        example: ./server -m 9900 9899
+ *                 curl http://127.0.0.1:9900/metrics
+ *
+ *        6. the server logs through a background thread, the reactors never
+ *        write to stdout themselves. -l <#level> keeps the lines up to that
+ *        level: 0 errors, 1 warnings, 2 connections (default), 3 debug.
+ *        example: ./server -l 1 9899
+ *
+ *        7. -i <#seconds> closes a connection without any traffic for that
+ *        long, -R <#seconds> one that has not sent anything for that long,
+ *        -W <#seconds> one that has not taken any of its pending echo for
+ *        that long. the timers live in a timing wheel per reactor, which also
+ *        decides how long epoll_wait sleeps.
+ *        example: ./server -i 60 -W 5 9899
+ *
+ *        8. -S <#seconds> logs what each reactor did over that period. the
+ *        reactors run such periodic work, and the refill of the log rate
+ *        limit and the trimming of the idle pipes, from a timerfd in their
+ *        epoll set.
+ *        example: ./server -S 10 9899
+ *
+ *        9. -b <#backlog> sets the listen backlog, the completed
+ *        connections the kernel queues until they are accepted (default:
+ *        /proc/sys/net/core/somaxconn, which also caps it). a reactor
+ *        accepts at most 64 of them per wakeup before serving its
+ *        established connections again.
+ *        example: ./server -b 1024 9899
+ *
+ *        10. -P <#protocol> picks the protocol the reactors run on the
+ *        connections (default: echo). a protocol is a proto_t of callbacks
+ *        (proto_util.h) registered in proto_util.c, the reactors do all the
+ *        socket io and hand it the input without copying. -s only applies
+ *        to the echo, which it runs in the kernel instead.
+ *        example: ./server -P echo 9899
+ *
+ *        11. -P frame echoes length-prefixed frames: each frame is a header
+ *        with the length of its payload, then the payload. -F <#header>
+ *        picks the header: 2 or 4 bytes big endian (default: 4), or a
+ *        varint. -M <#bytes> caps the payload (default: 65536), a client
+ *        announcing a larger frame is closed before any of it is buffered.
+ *        example: ./server -P frame -F varint -M 1048576 9899
+ *
+ *        12. -P relay broadcasts the frames: what a client sends goes to
+ *        every other client of the same reactor (run -t 1 for one room).
+ *        a reactor first serves all the events of a wakeup, then writes
+ *        out every connection they left output for, so the frames of many
+ *        senders reach each client in one write. a client that falls
+ *        256KB behind misses frames until it catches up.
+ *        example: ./server -t 1 -P relay -F 2 9899
+ *
  *        */
 
+static void usage(void)
+{
+    printf("usage: ./server [-t #reactors] [-a] [-s] [-z #bytes] [-m #port] [-l #level] [-i #seconds] [-R #seconds] [-W #seconds] [-S #seconds] [-b #backlog] [-P %s] [-F 2|4|varint] [-M #bytes] <#port>\n",
+           proto_names());
+    exit(EXIT_FAILURE);
+}
+
 int main(int argc, char *argv[])
 {
-    if (argc != 2)
+    int nreactors = online_cpus();
+    int pin = 0;
+    int admin_port = 0;
+    int level = LOG_INFO;
+    int opt;
+
+    server_conf.backlog = default_backlog();
+    server_conf.proto = &proto_echo;
+    server_conf.frame.header = FRAME_LEN32;
+    server_conf.frame.maxsize = FRAME_MAXSIZE;
+
+    while ( (opt = getopt(argc,argv,"t:asz:m:l:i:R:W:S:b:P:F:M:")) != -1 )
+    {
+        switch (opt)
+        {
+            case 't':
+                nreactors = atoi(optarg);
+                break;
+            case 'a':
+                pin = 1;
+                break;
+            case 's':
+                server_conf.splice = 1;
+                break;
+            case 'z':
+                server_conf.zerocopy = atoi(optarg);
+                break;
+            case 'm':
+                admin_port = atoi(optarg);
+                break;
+            case 'l':
+                level = atoi(optarg);
+                break;
+            case 'i':
+                server_conf.idle_timeout = atof(optarg) * 1000;
+                break;
+            case 'R':
+                server_conf.read_timeout = atof(optarg) * 1000;
+                break;
+            case 'W':
+                server_conf.write_timeout = atof(optarg) * 1000;
+                break;
+            case 'b':
+                server_conf.backlog = atoi(optarg);
+                break;
+            case 'S':
+                server_conf.report = atof(optarg) * 1000;
+                break;
+            case 'P':
+                if ( (server_conf.proto = proto_find(optarg)) == NULL )
+                {
+                    usage();
+                }
+                break;
+            case 'F':
+                if ( (server_conf.frame.header = frame_header_find(optarg)) < 0 )
+                {
+                    usage();
+                }
+                break;
+            case 'M':
+                server_conf.frame.maxsize = atoi(optarg);
+                break;
+            default:
+                usage();
+        }
+    }
+
+    if (optind != argc - 1 || nreactors <= 0 || level < LOG_ERROR || level > LOG_DEBUG ||
+        server_conf.idle_timeout < 0 || server_conf.read_timeout < 0 || server_conf.write_timeout < 0 ||
+        server_conf.report < 0 || server_conf.backlog <= 0 ||
+        (server_conf.splice && server_conf.proto != &proto_echo) ||
+        server_conf.frame.maxsize <= 0 || server_conf.frame.maxsize > (1 << 30))
     {
-        printf("usage: ./server <#port>\n");
-        exit(EXIT_FAILURE);
+        usage();
     }
-    int port = atoi(argv[1]);
+    int port = atoi(argv[optind]);
 
-    int listenfd = bind_sock(port);
+    /* a client closing early must not kill the server on write */
+    signal(SIGPIPE,SIG_IGN);
 
-    listen_sock(listenfd);
+    log_init(STDOUT_FILENO,level);
 
-    handle_connection(listenfd);
+    start_reactors(port,nreactors,pin,admin_port);
 
     return 0;
 }
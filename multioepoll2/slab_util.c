@@ -0,0 +1,95 @@
+#include  "slab_util.h"
+
+/* slab_grow: add a slab of .perslab objects to the free list
+ * @pool: the pool to grow
+ *
+ * */
+static void slab_grow(slab_pool_t *pool)
+{
+    int i;
+    char *slab = malloc(pool->objsize * pool->perslab);
+    assert(slab);
+
+    pool->slabs = realloc(pool->slabs,(pool->nslabs + 1) * sizeof(void *));
+    assert(pool->slabs);
+    pool->slabs[pool->nslabs++] = slab;
+
+    for (i = 0; i < pool->perslab; ++i)
+    {
+        slab_free(pool,slab + i * pool->objsize);
+    }
+    pool->ntotal += pool->perslab;
+}
+
+/* slab_init: initialize the pool with one slab of @count objects, later
+ * slabs have the same size
+ * @pool: the pool to be initialized
+ * @objsize: the size of each object
+ * @count: the number of objects preallocated
+ *
+ * */
+void slab_init(slab_pool_t *pool, size_t objsize, int count)
+{
+    /* the free list link lives inside the free objects, keep them aligned */
+    if (objsize < sizeof(void *))
+    {
+        objsize = sizeof(void *);
+    }
+    pool->objsize = (objsize + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+    pool->perslab = count > 0 ? count : 1;
+    pool->freelist = NULL;
+    pool->slabs = NULL;
+    pool->nslabs = 0;
+    pool->nfree = 0;
+    pool->ntotal = 0;
+
+    slab_grow(pool);
+}
+
+/* slab_alloc: take an object from the pool
+ * @pool: the pool
+ *
+ * */
+void *slab_alloc(slab_pool_t *pool)
+{
+    if (pool->freelist == NULL)
+    {
+        slab_grow(pool);
+    }
+
+    void *obj = pool->freelist;
+    pool->freelist = *(void **)obj;
+    pool->nfree--;
+    return obj;
+}
+
+/* slab_free: give @obj back to the pool it was taken from
+ * @pool: the pool
+ * @obj: the object
+ *
+ * */
+void slab_free(slab_pool_t *pool, void *obj)
+{
+    *(void **)obj = pool->freelist;
+    pool->freelist = obj;
+    pool->nfree++;
+}
+
+/* slab_destroy: release all the slabs, the objects must not be used after
+ * @pool: the pool
+ *
+ * */
+void slab_destroy(slab_pool_t *pool)
+{
+    int i;
+    for (i = 0; i < pool->nslabs; ++i)
+    {
+        free(pool->slabs[i]);
+    }
+    free(pool->slabs);
+    pool->slabs = NULL;
+    pool->nslabs = 0;
+    pool->freelist = NULL;
+    pool->nfree = 0;
+    pool->ntotal = 0;
+}
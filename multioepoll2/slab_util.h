@@ -0,0 +1,44 @@
+#ifndef  SLAB_UTIL_H
+#define  SLAB_UTIL_H
+
+#include  <stdlib.h>
+#include  <assert.h>
+
+/* slab_pool: a pool of fixed-size objects carved out of big slabs
+ * .objsize: the size of each object
+ * .perslab: the number of objects in each slab
+ * .freelist: the free objects, linked through their first word
+ * .slabs/.nslabs: the slabs, only released by slab_destroy
+ * .nfree: the number of objects on the free list
+ * .ntotal: the number of objects in all slabs
+ *
+ * a pool belongs to one thread, so allocating and freeing are a pointer
+ * push or pop without any lock. a new slab is only malloced when the free
+ * list runs dry, so once the pool has grown to the peak number of objects
+ * in use, churning objects never calls malloc or free again
+ *
+ * */
+typedef struct slab_pool
+{
+    size_t objsize;
+    int perslab;
+    void *freelist;
+    void **slabs;
+    int nslabs;
+    int nfree;
+    int ntotal;
+}slab_pool_t;
+
+/* initialize the pool and preallocate @count objects of @objsize bytes */
+void slab_init(slab_pool_t *pool, size_t objsize, int count);
+
+/* take an object from the pool, adding a slab if it is empty */
+void *slab_alloc(slab_pool_t *pool);
+
+/* give @obj back to the pool */
+void slab_free(slab_pool_t *pool, void *obj);
+
+/* release all the slabs of the pool */
+void slab_destroy(slab_pool_t *pool);
+
+#endif  /*SLAB_UTIL_H*/
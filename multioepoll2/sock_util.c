@@ -1,63 +1,70 @@
 #include  "sock_util.h"
 
-/* sock_bind: create and bind a new socket with @port
- * @port: the port used to bind the socket
+server_conf_t server_conf;
+
+/* do_refill: the periodic task refilling the log rate limit of the loop
+ * @arg: unused
  *
  * */
-int bind_sock(int port)
+static void do_refill(void *arg)
 {
-    int listenfd;
-    struct sockaddr_in socket_addr;
-
-    /* create a new socket */
-    if ((listenfd = socket(AF_INET,SOCK_STREAM,0)) < 0)
-    {
-        perror_exit("socket error");
-    }
-
-    /* fill the socket address struct */
-    memset(&socket_addr,0,sizeof(struct sockaddr_in));
-    socket_addr.sin_family = AF_INET;
-    socket_addr.sin_port = htons(port);
-    socket_addr.sin_addr.s_addr = htonl(INADDR_ANY);
-
-    /* bind the socket */
-    if (bind(listenfd,(struct sockaddr *)&socket_addr,sizeof(struct sockaddr_in)) < 0)
-    {
-        perror_exit("bind error");
-    }
+    (void)arg;
+    log_refill();
+}
 
-    return listenfd;
+/* do_trim: the periodic task shrinking the pipe pool of the loop
+ * @arg: the connection table
+ *
+ * */
+static void do_trim(void *arg)
+{
+    conn_pipe_trim(arg);
 }
 
-/* sock_listen: listen the @listenfd socket
- * @listenfd: the socket used for listening
+/* do_report: the periodic task logging what the loop did since the last
+ * report, next to the live counters the metrics port serves
+ * @arg: the statistics of the loop
  *
  * */
-void listen_sock(int listenfd)
+static void do_report(void *arg)
 {
-    if (listen(listenfd,LISTENQ) < 0)
-    {
-        perror_exit("listen error");
-    }
+    loop_stats_t *stats = arg;
+    loop_counters_t *now = &stats->counters, *last = &stats->reported;
+
+    log_info("reactor %d: accepts %llu closes %llu timeouts %llu bytes in %llu out %llu "
+             "writes %llu wakeups %llu events %llu active %llu service p99 %.1fus",
+             stats->id,now->accepts - last->accepts,now->closes - last->closes,
+             now->timeouts - last->timeouts,now->bytes_in - last->bytes_in,
+             now->bytes_out - last->bytes_out,now->writes - last->writes,
+             now->wakeups - last->wakeups,
+             now->events - last->events,now->accepts - now->closes,
+             hist_percentile(&stats->service,99) / 1000.0);
+    *last = *now;
 }
 
 /* handle_connection: handle the connected clients
  * @listenfd: the socket used to accept connections
+ * @stats: the timings the loop records
  *
  * */
-void handle_connection(int listenfd)
+void handle_connection(int listenfd, loop_stats_t *stats)
 {
-    /* the number of readable fds in the pollfd array */
+    /* the number of ready fds in the epoll set */
     int nready, i;
 
-    /* receive buffer */
-    buffer_t recvbuf;
-    memset(&recvbuf,0,sizeof(buffer_t));
+    /* the connections indexed by fd, each with its own buffers */
+    conn_table_t table;
+    conn_table_init(&table);
+    table.counters = &stats->counters;
 
     /* set the listenfd to non-block */
     setnonblock(listenfd);
 
+    /* the listen socket is edge triggered, the connections a full batch
+     * leaves behind raise no new edge, so the loop keeps accepting without
+     * sleeping until the backlog is drained */
+    int accept_pending = 0;
+
     /* epollfd set to monitor the related events */
     int epollfd;
     if ( (epollfd = epoll_create(EPOLL_SIZE)) < 0 )
@@ -72,196 +79,833 @@ void handle_connection(int listenfd)
     int state = EPOLLIN | EPOLLET;
     add_epoll_event(epollfd,listenfd,state);
 
+    /* the periodic work of the loop runs from its own timerfd, no thread
+     * of its own */
+    sched_t sched;
+    sched_task_t refill, trim, report;
+    sched_init(&sched,epollfd);
+    sched_task_init(&refill);
+    sched_task_init(&trim);
+    sched_task_init(&report);
+
+    log_refill();
+    sched_add(&sched,&refill,1000000000LL,1000000000LL,do_refill,NULL);
+    if (server_conf.splice)
+    {
+        sched_add(&sched,&trim,PIPE_TRIM_MS * 1000000LL,PIPE_TRIM_MS * 1000000LL,do_trim,&table);
+    }
+    if (server_conf.report > 0)
+    {
+        stats->reported = stats->counters;
+        sched_add(&sched,&report,server_conf.report * 1000000LL,server_conf.report * 1000000LL,
+                  do_report,stats);
+    }
+
     while( 1 )
     {
         /* obtain the ready sockets from the epoll set */
-        if ( (nready = epoll_wait(epollfd,events,EPOLL_EVENTS,INFTIM)) < 0)
+        /* the wheel decides how long the loop may sleep, INFTIM without
+         * any timer armed */
+        if ( (nready = epoll_wait(epollfd,events,EPOLL_EVENTS,
+                                  accept_pending ? 0 : wheel_timeout(&table.wheel))) < 0)
         {
+            if (errno == EINTR)
+            {
+                continue;
+            }
             perror_exit("epoll wait error");
         }
+        long long woken = now_ns();
+
+        /* close the connections whose deadline has passed */
+        wheel_advance(&table.wheel,woken / 1000000,conn_expire,&table);
+        counter_add(&stats->counters,wakeups,1);
+        counter_add(&stats->counters,events,nready);
 
         /* traverse the ready sockets */
         for (i = 0; i < nready; ++i)
         {
             int fd = events[i].data.fd;
+            long long start = now_ns();
+            hist_record(&stats->wake,start - woken);
 
-            /* listenfd is ready */
-            if ( fd == listenfd && (events[i].events & EPOLLIN) )
+            /* listenfd is ready, accepted after the established connections
+             * have had their turn */
+            if ( fd == listenfd )
             {
-                do_accept(listenfd, epollfd);
+                accept_pending = 1;
+                continue;
             }
 
-            /* connected sockets are ready */
-            else if ( events[i].events & EPOLLIN )
+            /* the timerfd, some tasks are due */
+            if ( fd == sched.fd )
             {
-                do_read(fd,epollfd,&recvbuf);
+                sched_run(&sched);
+                continue;
             }
 
-            /* read the data from the connected socket and echo it also */
-            else if ( events[i].events & EPOLLOUT )
+            /* the connection may have been closed earlier in this batch */
+            conn_t *conn = conn_get(&table,fd);
+            if (conn == NULL)
             {
-                do_write(fd,epollfd,&recvbuf);
+                continue;
             }
+
+            /* the zero copy completions are queued on the error queue */
+            if ( (events[i].events & EPOLLERR) && chain_haspinned(&conn->outq) > 0 )
+            {
+                if (do_zerocopy_reap(conn) < 0)
+                {
+                    chain_destroy(&conn->outq);
+                    do_close(conn,&table);
+                    continue;
+                }
+            }
+
+            /* record the edges, errors are reported by the next read */
+            if ( events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP) )
+            {
+                conn->readable = 1;
+            }
+            if ( (events[i].events & EPOLLIN) && conn->accepted )
+            {
+                hist_record(&stats->first_byte,start - conn->accepted);
+                conn->accepted = 0;
+            }
+            if ( events[i].events & EPOLLOUT )
+            {
+                conn->writable = 1;
+            }
+
+            do_io(conn,&table);
+            hist_record(&stats->service,now_ns() - start);
+        }
+
+        if (accept_pending)
+        {
+            accept_pending = do_accept(listenfd,epollfd,&table);
         }
+
+        /* all the events are in, write out what they queued */
+        do_flush_pass(&table);
     }
 }
 
-/* do_accept: establish the new connection
+/* do_accept: establish up to ACCEPT_BATCH new connections, so a storm of
+ * connections cannot keep the loop from the established ones
  * @listenfd: the listening fd
  * @epollfd: the epollfd used to monitor the listening fd and new connected fd
+ * @table: the connection table the new connection is added into
+ *
+ * return 1 if the batch is full and more connections may be waiting, 0 if
+ * the backlog is drained
  *
  * */
-void do_accept(int listenfd, int epollfd)
+int do_accept(int listenfd, int epollfd, conn_table_t *table)
 {
-    int connfd;
+    int connfd, n;
     struct sockaddr_in clitaddr;
-    socklen_t socklen;
-    while ( (connfd = accept(listenfd,(struct sockaddr *)&clitaddr,&socklen)) > 0 )
+    socklen_t socklen = sizeof(struct sockaddr_in);
+
+    for (n = 0; n < ACCEPT_BATCH; ++n)
     {
-        /* show client info */
-        show_peer_info(connfd);
+        /* non-blocking from the start, without the fcntl pair */
+        if ( (connfd = accept4(listenfd,(struct sockaddr *)&clitaddr,&socklen,
+                               SOCK_NONBLOCK | SOCK_CLOEXEC)) < 0 )
+        {
+            break;
+        }
 
-        /* set the connfd to non-block socket */
-        setnonblock(connfd);
+        /* show client info, from the address accept returned, through the
+         * logger so the loop never blocks on stdout */
+        log_addr_info(&clitaddr);
 
-        /* set the connfd events to EPOLLIN | EPLLET(edge trigger) */
-        int state =  EPOLLIN | EPOLLET;
+        conn_t *conn = conn_new(table,connfd);
+        conn->accepted = now_ns();
+        conn_rearm(conn,table);
+        counter_add(table->counters,accepts,1);
+
+        /* the protocol turned the client down */
+        if (server_conf.proto->on_accept && server_conf.proto->on_accept(conn) < 0)
+        {
+            do_close(conn,table);
+            socklen = sizeof(struct sockaddr_in);
+            continue;
+        }
+
+        /* without a pipe the connection falls back to the buffers */
+        if (server_conf.splice && conn_pipe_get(table,conn) < 0)
+        {
+            log_warn("pipe error: %s",strerror(errno));
+        }
+
+        /* without SO_ZEROCOPY every write copies */
+        int on = 1;
+        if (server_conf.zerocopy > 0 &&
+            setsockopt(connfd,SOL_SOCKET,SO_ZEROCOPY,&on,sizeof(on)) == 0)
+        {
+            conn->zerocopy = 1;
+        }
+
+        /* the connection is registered for both directions once, with edge
+         * trigger we only hear about the transitions, so it never has to be
+         * modified when switching between reading and writing */
+        int state =  EPOLLIN | EPOLLOUT | EPOLLET;
+        conn->writable = 1;
 
         /* add connected fd to epoll set */
         add_epoll_event(epollfd,connfd,state);
+
+        socklen = sizeof(struct sockaddr_in);
+    }
+
+    if (n == ACCEPT_BATCH)
+    {
+        return 1;
     }
 
     /* if accept error*/
-    if (connfd < 0)
+    if (errno == EMFILE || errno == ENFILE)
+    {
+        /* the connections wait in the backlog until the next edge, retrying
+         * now would spin */
+        log_warn("accept error: %s",strerror(errno));
+    }
+    else if (errno == ECONNABORTED || errno == EPROTO || errno == EINTR)
+    {
+        /* only this connection failed, the next one may be fine */
+        return 1;
+    }
+    else if (errno != EAGAIN)
+    {
+        perror_exit("accept error");
+    }
+    return 0;
+}
+
+/* do_touch: record the traffic of @conn for its timeouts, a deadline pushed
+ * later costs nothing here, the timer finds out when it expires
+ * @conn: the connection
+ * @table: the connection table the connection belongs to
+ * @nin: the bytes read
+ * @nout: the bytes written
+ * @pending: whether output was waiting before the traffic
+ *
+ * */
+static void do_touch(conn_t *conn, conn_table_t *table, int nin, int nout, int pending)
+{
+    long long now = table->wheel.now;
+
+    if (nin > 0)
+    {
+        conn->last_read = now;
+    }
+
+    /* the write timeout counts from the last progress, or from when the
+     * output started waiting */
+    if (nout > 0 || pending == 0)
+    {
+        conn->last_write = now;
+    }
+
+    conn_rearm(conn,table);
+}
+
+/* do_io: read the data of @conn and dispatch it until the socket is drained,
+ * every request found in the input is answered before anything is written,
+ * the answers wait in the output queue for the flush pass after the events,
+ * so pipelined requests cost one write per wakeup, not one each. in splice
+ * mode the data is moved both ways right away, it never reaches a queue
+ * @conn: the connection to be served
+ * @table: the connection table the connection belongs to
+ *
+ * */
+void do_io(conn_t *conn, conn_table_t *table)
+{
+    int nread;
+    int nin = 0, nout = 0;
+    int pending = chain_hasdata(&conn->outq) > 0 || conn->inpipe > 0;
+
+    /* waiting for the zero copy completions only */
+    if (conn->closing)
+    {
+        do_close(conn,table);
+        return;
+    }
+
+    /* the data never leaves the kernel in splice mode */
+    if (conn->pipefd[0] >= 0)
+    {
+        if (do_splice(conn,&nin,&nout) < 0)
+        {
+            do_close(conn,table);
+        }
+        else if (conn->eof && conn->inpipe == 0)
+        {
+            do_close(conn,table);
+        }
+        else
+        {
+            do_touch(conn,table,nin,nout,pending);
+        }
+        return;
+    }
+
+    /* take in all the socket has and answer every complete request in it,
+     * until the socket is drained or the queue is over CHAIN_HIGHWAT */
+    do
     {
-        if (errno != EAGAIN && errno != ECONNABORTED && errno != EPROTO && errno != EINTR)
+        if ( (nread = do_read(conn)) < 0 )
+        {
+            do_close(conn,table);
+            return;
+        }
+
+        if ( do_dispatch(conn) < 0 )
         {
-            perror_exit("accept error");
+            do_close(conn,table);
+            return;
         }
+
+        nin += nread;
+    } while (nread > 0 && conn->readable && chain_hasdata(&conn->outq) < CHAIN_HIGHWAT);
+
+    /* the client has sent "FIN" and all the answers have been sent, what is
+     * left of the input is a message the client never finished */
+    if (conn->eof && chain_hasdata(&conn->outq) == 0)
+    {
+        do_close(conn,table);
+        return;
+    }
+
+    /* an EPOLLOUT for output left over from an earlier pass */
+    if (conn->writable && chain_hasdata(&conn->outq) > 0)
+    {
+        conn_dirty(conn);
+    }
+
+    do_touch(conn,table,nin,0,pending);
+}
+
+/* do_flush: write out what the loop queued for @conn during the events,
+ * answers and data other connections sent to it alike, with one writev
+ * @conn: the connection to be flushed
+ * @table: the connection table the connection belongs to
+ *
+ * */
+void do_flush(conn_t *conn, conn_table_t *table)
+{
+    int nwrite;
+    int pending = chain_hasdata(&conn->outq) > 0;
+
+    if (conn->closing)
+    {
+        return;
+    }
+
+    if ( (nwrite = do_write(conn)) < 0 )
+    {
+        do_close(conn,table);
+        return;
+    }
+
+    /* the protocol may have more to send once the queue is out, it goes
+     * on the dirty list again and is flushed later in the same pass */
+    if ( nwrite > 0 && chain_hasdata(&conn->outq) == 0 && server_conf.proto->on_writable )
+    {
+        server_conf.proto->on_writable(conn);
+    }
+
+    do_touch(conn,table,0,nwrite,pending);
+
+    /* the room made lets the input held back by CHAIN_HIGHWAT in */
+    if ( nwrite > 0 && (conn->readable || buffer_hasdata(&conn->inbuf) > 0) )
+    {
+        do_io(conn,table);
+        return;
+    }
+
+    if (conn->eof && chain_hasdata(&conn->outq) == 0)
+    {
+        do_close(conn,table);
     }
 }
 
-void do_read(int fd, int epollfd, buffer_t *recvbuf)
+/* do_flush_pass: flush every connection on the dirty list of @table, the
+ * second half of each loop cycle, the list may grow while it is walked
+ * @table: the connection table
+ *
+ * */
+void do_flush_pass(conn_table_t *table)
 {
-    int space = buffer_hasspace(recvbuf);
-    if (space > 0)
+    int i;
+
+    for (i = 0; i < table->ndirty; ++i)
     {
-        /* trial read */
-        int nread = read(fd,recvbuf->buffer + recvbuf->in,space);
+        conn_t *conn = conn_get(table,table->dirty[i]);
+
+        /* closed since, or the fd taken by a connection flushed already */
+        if (conn == NULL || conn->dirty == 0)
+        {
+            continue;
+        }
+        conn->dirty = 0;
+
+        counter_add(table->counters,flushes,1);
+        do_flush(conn,table);
+    }
+    table->ndirty = 0;
+}
+
+/* do_read: read the data from the socket into the input buffer until the
+ * socket is drained or the buffer is full and can not grow any more
+ * @conn: the connection to read from
+ *
+ * return the number of bytes read, -1 if the connection is broken
+ *
+ * */
+int do_read(conn_t *conn)
+{
+    buffer_t *recvbuf = &conn->inbuf;
+    int ntotal = 0;
+
+    while ( conn->readable )
+    {
+        if ( buffer_hasspace(recvbuf) == 0 && buffer_grow(recvbuf) < 0 )
+        {
+            break;
+        }
+
+        int nread = buffer_readfd(recvbuf,conn->fd);
 
         /* read error */
         if (nread < 0)
         {
-            if (errno != EAGAIN)
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            /* the socket is drained, wait for the next EPOLLIN */
+            if (errno == EAGAIN)
             {
-                perror_exit("read error");
+                conn->readable = 0;
+                counter_add(conn->counters,eagain_read,1);
+                break;
             }
+            return -1;
         }
 
         /* read "FIN" from client */
         else if (nread == 0)
         {
-            delete_epoll_event(epollfd,fd,EPOLLIN);
-            close(fd);
+            conn->readable = 0;
+            conn->eof = 1;
+            break;
         }
 
+        ntotal += nread;
+    }
+
+    counter_add(conn->counters,bytes_in,ntotal);
+    return ntotal;
+}
+
+/* do_dispatch: pass the input of @conn to the protocol, straight from the
+ * input buffer, for as long as it consumes some. a message cut in two by the
+ * end of the ring is made one segment first, which only costs a copy when
+ * the ring wraps in the middle of a message
+ * @conn: the connection to serve
+ *
+ * return 0, -1 if the protocol closes the connection
+ *
+ * */
+int do_dispatch(conn_t *conn)
+{
+    buffer_t *recvbuf = &conn->inbuf;
+    struct iovec iov[2];
+    int nseg, n;
+
+    /* the client is not reading what it is sent, leave the input where it
+     * is so that reading stops once the input buffer is full */
+    while ( buffer_hasdata(recvbuf) > 0 && chain_hasdata(&conn->outq) < CHAIN_HIGHWAT )
+    {
+        nseg = buffer_data_iov(recvbuf,iov);
+        if ( (n = server_conf.proto->on_data(conn,iov[0].iov_base,iov[0].iov_len)) < 0 )
+        {
+            return -1;
+        }
+        buffer_consume(recvbuf,n);
+
+        /* the rest is a message waiting for more data */
+        if (n < (int)iov[0].iov_len)
+        {
+            if (nseg == 1)
+            {
+                break;
+            }
+            buffer_unwrap(recvbuf);
+        }
+    }
+
+    return 0;
+}
+
+/* do_write: write the output queue to the socket until it is empty or the
+ * socket send buffer is full, each writev takes every queued segment. a
+ * partial write just parks the rest until the next EPOLLOUT, so one slow
+ * reader never stalls the other connections
+ * @conn: the connection to write to
+ *
+ * return the number of bytes written, -1 if the connection is broken
+ *
+ * */
+int do_write(conn_t *conn)
+{
+    chain_t *outq = &conn->outq;
+    int ntotal = 0;
+
+    while ( conn->writable && chain_hasdata(outq) > 0 )
+    {
+        /* small writes are cheaper to copy than to pin and reap */
+        int nwrite;
+        if (conn->zerocopy && chain_hasdata(outq) >= server_conf.zerocopy)
+        {
+            nwrite = chain_sendzc(outq,conn->fd);
+        }
         else
         {
-            recvbuf->in += nread;
+            nwrite = chain_writefd(outq,conn->fd);
+        }
+        counter_add(conn->counters,writes,1);
 
-            /* read the whole data from the socket */
-            while( (nread = read(fd,recvbuf->buffer + recvbuf->in,space)) > 0 )
+        /* write error */
+        if (nwrite < 0)
+        {
+            if (errno == EINTR)
             {
-                recvbuf->in += nread;
+                continue;
             }
 
-            /* read error */
-            if (nread < 0)
+            /* the socket send buffer is full, wait for the next EPOLLOUT */
+            if (errno == EAGAIN)
             {
-                if (errno != EAGAIN)
+                conn->writable = 0;
+                counter_add(conn->counters,eagain_write,1);
+                if (ntotal > 0)
                 {
-                    perror_exit("read error");
+                    counter_add(conn->counters,partial_writes,1);
                 }
+                break;
+            }
+            return -1;
+        }
+
+        ntotal += nwrite;
+    }
+
+    counter_add(conn->counters,bytes_out,ntotal);
+    return ntotal;
+}
+
+/* do_zerocopy_reap: read the zero copy completions from the error queue of
+ * the socket and release the segments whose sends are done
+ * @conn: the connection
+ *
+ * return 0, -1 if the error queue can not be read
+ *
+ * */
+int do_zerocopy_reap(conn_t *conn)
+{
+    char control[128];
+    struct msghdr msg;
+    struct cmsghdr *cm;
+    struct sock_extended_err *serr;
+
+    while ( 1 )
+    {
+        memset(&msg,0,sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (recvmsg(conn->fd,&msg,MSG_ERRQUEUE) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            /* the error queue is drained */
+            if (errno == EAGAIN)
+            {
+                return 0;
+            }
+            return -1;
+        }
+
+        for (cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg,cm))
+        {
+            if (cm->cmsg_level != SOL_IP || cm->cmsg_type != IP_RECVERR)
+            {
+                continue;
+            }
+
+            serr = (struct sock_extended_err *)CMSG_DATA(cm);
+            if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+            {
+                continue;
+            }
+
+            /* the kernel had to copy anyway (loopback, no scatter-gather
+             * support), pinning buys nothing on this connection */
+            if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+            {
+                conn->zerocopy = 0;
             }
 
-            /* data is ready for writing */
-            modify_epoll_event(epollfd,fd,EPOLLOUT);
+            chain_zc_complete(&conn->outq,serr->ee_info,serr->ee_data);
         }
     }
 }
 
-void do_write(int fd,int epollfd,buffer_t *sendbuf)
+/* do_splice: move the data of @conn from the socket into its pipe and from
+ * the pipe back to the socket, without copying it into the user space, until
+ * neither direction can make progress
+ * @conn: the connection to echo
+ * @nin: the bytes read are added to it
+ * @nout: the bytes written are added to it
+ *
+ * return 0, -1 if the connection is broken
+ *
+ * */
+int do_splice(conn_t *conn, int *nin, int *nout)
 {
-    int ntotal = strlen(sendbuf->buffer);
+    int progress;
+    ssize_t n;
 
-    /* write the whole data to the socket even if the socket send buffer is
-     * full(write function will return -1 and errno = EAGAIN), we should do
-     * the while loop until all data gets sent out */
-    while( ntotal > 0 )
+    do
     {
-        int nwrite = write(fd,sendbuf->buffer + sendbuf->out,ntotal);
-        /* write error */
-        if (nwrite < 0)
+        progress = 0;
+
+        /* socket -> pipe, stops when the pipe is full so that a client not
+         * reading its echo is not read from any more */
+        while ( conn->readable && conn->inpipe < PIPE_SIZE )
         {
-            if (errno != EAGAIN)
+            n = splice(conn->fd,NULL,conn->pipefd[1],NULL,PIPE_SIZE - conn->inpipe,
+                       SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (n < 0)
             {
-                perror_exit("write error");
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                /* a full pipe reports EAGAIN as well, only an empty one
+                 * means the socket is drained */
+                if (errno == EAGAIN)
+                {
+                    if (conn->inpipe == 0)
+                    {
+                        conn->readable = 0;
+                        counter_add(conn->counters,eagain_read,1);
+                    }
+                    break;
+                }
+                return -1;
             }
-            /* if nwrite < 0 and errno = EAGAIN, which means the send socket
-             * buffer is full, we should:
-             * 1. modify_epoll_event(epollfd, fd, EPOLLIN);
-             * 2. break the while loop;
-             * this make things complicate since we only have one receive and
-             * send buffer, if there is other connection, that will corrupt
-             * the data.
-             *
-             * thus, each time, we read the whole data from receive buffer and
-             * then send them out*/
+
+            /* read "FIN" from client */
+            else if (n == 0)
+            {
+                conn->readable = 0;
+                conn->eof = 1;
+                break;
+            }
+
+            conn->inpipe += n;
+            *nin += n;
+            counter_add(conn->counters,bytes_in,n);
+            progress = 1;
         }
 
-        else
+        /* pipe -> socket */
+        while ( conn->writable && conn->inpipe > 0 )
         {
-            sendbuf->out += nwrite;
-            ntotal -= nwrite;
+            n = splice(conn->pipefd[0],NULL,conn->fd,NULL,conn->inpipe,
+                       SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            counter_add(conn->counters,writes,1);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                /* the socket buffer is full, wait for the next EPOLLOUT */
+                if (errno == EAGAIN)
+                {
+                    conn->writable = 0;
+                    counter_add(conn->counters,eagain_write,1);
+                    counter_add(conn->counters,partial_writes,1);
+                    break;
+                }
+                return -1;
+            }
+
+            conn->inpipe -= n;
+            *nout += n;
+            counter_add(conn->counters,bytes_out,n);
+            progress = 1;
         }
+    } while (progress);
+
+    return 0;
+}
+
+/* conn_deadline: the earliest of the timeouts that apply to @conn now
+ * @conn: the connection
+ *
+ * return the tick, -1 if none applies
+ *
+ * */
+long long conn_deadline(const conn_t *conn)
+{
+    long long deadline = -1, t;
+
+    if (server_conf.idle_timeout > 0)
+    {
+        t = (conn->last_read > conn->last_write ? conn->last_read : conn->last_write)
+            + server_conf.idle_timeout;
+        deadline = t;
+    }
+
+    /* the client that has sent "FIN" has nothing more to send */
+    if (server_conf.read_timeout > 0 && conn->eof == 0)
+    {
+        t = conn->last_read + server_conf.read_timeout;
+        deadline = (deadline < 0 || t < deadline) ? t : deadline;
     }
 
-    /* all data has been sent out, reset the buffer space */
-    if ( sendbuf->in == sendbuf->out )
+    if (server_conf.write_timeout > 0 && (chain_hasdata(&conn->outq) > 0 || conn->inpipe > 0))
     {
-        buffer_reset(sendbuf);
+        t = conn->last_write + server_conf.write_timeout;
+        deadline = (deadline < 0 || t < deadline) ? t : deadline;
     }
-    /* modify the fd from epoll set to EPOLLIN since all data has been sent out */
-    modify_epoll_event(epollfd,fd,EPOLLIN);
+
+    return deadline;
 }
 
-/* show_client_info: show the client information including ip address and port
- * @connfd: the connected fd used to show the information
+/* conn_rearm: arm the timer of @conn at its deadline if it is not armed or
+ * armed later, a deadline that moved later is left to conn_expire
+ * @conn: the connection
+ * @table: the connection table the connection belongs to
  *
  * */
-void show_peer_info(int connfd)
+void conn_rearm(conn_t *conn, conn_table_t *table)
 {
-    struct sockaddr_in clitaddr;
-    socklen_t socklen;
+    long long deadline = conn_deadline(conn);
+
+    if (deadline >= 0 && (conn->timer.next == NULL || deadline < conn->timer.expire))
+    {
+        wheel_add(&table->wheel,&conn->timer,deadline);
+    }
+}
 
-    if ((getpeername(connfd,(struct sockaddr *)&clitaddr,&socklen)) < 0)
+/* conn_expire: the timer of a connection expired, the deadline is worked
+ * out again from the last traffic, a connection that was active since is
+ * re-armed, one that was not is closed
+ * @timer: the timer of the connection
+ * @arg: the connection table
+ *
+ * */
+void conn_expire(wheel_timer_t *timer, void *arg)
+{
+    conn_table_t *table = arg;
+    conn_t *conn = (conn_t *)((char *)timer - offsetof(conn_t,timer));
+    long long deadline = conn_deadline(conn);
+
+    if (deadline < 0)
+    {
+        return;
+    }
+    if (deadline > table->wheel.now)
     {
-        perror_exit("getpeername error");
+        wheel_add(&table->wheel,timer,deadline);
+        return;
     }
 
-    char ipaddr[20];
+    log_info("timeout: fd %d",conn->fd);
+    counter_add(table->counters,timeouts,1);
+    do_close(conn,table);
+}
 
-    if (inet_ntop(AF_INET,&clitaddr.sin_addr,ipaddr,socklen) < 0)
+/* do_close: close the connection and release its buffers, closing the fd
+ * also removes it from the epoll set
+ * @conn: the connection to be closed
+ * @table: the connection table the connection belongs to
+ *
+ * */
+void do_close(conn_t *conn, conn_table_t *table)
+{
+    /* the protocol hears about it once, a connection waiting for its zero
+     * copy completions is already closed as far as it is concerned */
+    if (conn->closing == 0 && server_conf.proto->on_close)
     {
-        perror_exit("inet_ntop error");
+        server_conf.proto->on_close(conn);
     }
 
-    int port = ntohs(clitaddr.sin_port);
-    printf("peer information: %s:%d\n", ipaddr, port);
+    /* the kernel may still be sending from pinned segments, closing now
+     * would let them be reused under it, so only "FIN" is sent and the
+     * socket is closed once the completions are reaped */
+    if (chain_haspinned(&conn->outq) > 0)
+    {
+        if (conn->closing == 0)
+        {
+            conn->closing = 1;
+            conn->readable = 0;
+            shutdown(conn->fd,SHUT_WR);
+        }
+        return;
+    }
+
+    close(conn->fd);
+    counter_add(table->counters,closes,1);
+    conn_free(table,conn);
 }
 
 
-/* client handle the info received from both server and standard input
+/* set_epoll_event: register @fd in the @epollfd set for exactly @state,
+ * adding, modifying or deleting it as needed
+ * @epollfd: the epoll set
+ * @fd: the fd to be registered
+ * @cur: the events the fd is registered for now, 0 if it is not in the set
+ * @state: the events the fd should be registered for, 0 to remove it
+ *
+ * */
+static void set_epoll_event(int epollfd, int fd, int *cur, int state)
+{
+    if (state == *cur)
+    {
+        return;
+    }
+
+    if (*cur == 0)
+    {
+        add_epoll_event(epollfd,fd,state);
+    }
+    else if (state == 0)
+    {
+        delete_epoll_event(epollfd,fd,*cur);
+    }
+    else
+    {
+        modify_epoll_event(epollfd,fd,state);
+    }
+    *cur = state;
+}
+
+/* client handle the info received from both server and standard input, the
+ * data is carried by length only so any binary input is echoed untouched
  * @connfd: the connected socket used for communication
  *
  */
@@ -269,14 +913,16 @@ void client_info(int connfd)
 {
     int i;
 
-    int shutdown_flag = 0;
+    /* "EOF" has been read from standard input, and "FIN" sent after it */
+    int stdin_eof = 0, shutdown_flag = 0;
+
+    /* the events each fd is registered for */
+    int instate = 0, connstate = 0, outstate = 0;
 
     /* recv and send buffer */
     buffer_t recvbuf, sendbuf;
-    memset(&recvbuf,0,sizeof(buffer_t));
-    memset(&sendbuf,0,sizeof(buffer_t));
-
-    //setnonblock(connfd);
+    buffer_init(&recvbuf);
+    buffer_init(&sendbuf);
 
     /* epollfd set monitors conncted socket fd and standard input, if either one is
      * readable, then we obtain the info from it*/
@@ -288,217 +934,109 @@ void client_info(int connfd)
     struct epoll_event events[4];
     int nready;
 
-    add_epoll_event(epollfd,STDIN_FILENO,EPOLLIN);
-
     while( 1 )
     {
+        /* every fd waits for what the buffers let it do next: read while
+         * there is space, write while there is data */
+        set_epoll_event(epollfd,STDIN_FILENO,&instate,
+                (!stdin_eof && buffer_hasspace(&sendbuf) > 0) ? EPOLLIN : 0);
+        set_epoll_event(epollfd,connfd,&connstate,
+                (buffer_hasspace(&recvbuf) > 0 ? EPOLLIN : 0) | (buffer_hasdata(&sendbuf) > 0 ? EPOLLOUT : 0));
+        set_epoll_event(epollfd,STDOUT_FILENO,&outstate,
+                buffer_hasdata(&recvbuf) > 0 ? EPOLLOUT : 0);
+
         if ( (nready = epoll_wait(epollfd,events,4,INFTIM)) < 0 )
         {
-            perror("epollfd error");
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror_exit("epollfd error");
         }
 
         for (i = 0; i < nready; ++i)
         {
             fd = events[i].data.fd;
 
-            if (fd == STDIN_FILENO && (events[i].events & EPOLLIN) )
+            if (fd == STDIN_FILENO && (events[i].events & (EPOLLIN | EPOLLHUP)) )
             {
-                int space = buffer_hasspace(&sendbuf);
-                if (space > 0)
-                {
-                    int nread = read(fd,&sendbuf.buffer[sendbuf.in],space);
+                int nread = buffer_readfd(&sendbuf,fd);
 
-                    /* read error */
-                    if (nread < 0)
-                    {
-                        if (errno != EINTR)
-                        {
-                            perror_exit("read error");
-                        }
-                    }
-
-                    else if (nread == 0)
+                /* read error */
+                if (nread < 0)
+                {
+                    if (errno != EINTR)
                     {
-                        /* read "ctrl+d" from client, close the connection and delete the event from epoll set */
-                        shutdown_flag = 1;
-                        shutdown(connfd,SHUT_WR);
-                        add_epoll_event(epollfd,connfd,EPOLLIN);
-                        delete_epoll_event(epollfd,fd, EPOLLIN);
+                        perror_exit("read error");
                     }
+                }
 
-                    else
-                    {
-                        sendbuf.in += nread;
-
-                        /* add connection fd to epoll set */
-                        add_epoll_event(epollfd,connfd,EPOLLOUT);
-                    }
+                /* read "ctrl+d" from client, the connection is shut down
+                 * once the data before it has been sent */
+                else if (nread == 0)
+                {
+                    stdin_eof = 1;
                 }
             }
 
             if (fd == connfd && (events[i].events & EPOLLOUT) )
             {
-                int ntotal = strlen(sendbuf.buffer);
-
-                int nwrite = write(fd,&sendbuf.buffer[sendbuf.out],ntotal);
-
-                if (nwrite < 0)
+                if (buffer_writefd(&sendbuf,fd) < 0)
                 {
                     perror_exit("write error");
                 }
-
-                else
-                {
-                    sendbuf.out += ntotal;
-
-                    /* all data has benn sent out, reset the buffer space */
-                    if (sendbuf.in == sendbuf.out)
-                    {
-                        buffer_reset(&sendbuf);
-                    }
-
-                    /* modify the fd from epoll set to EPOLLIN since all data has been sent out */
-                    modify_epoll_event(epollfd,fd,EPOLLIN);
-                }
             }
 
-            if (fd == connfd && (events[i].events & EPOLLIN) )
+            if (fd == connfd && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) )
             {
-                int space = buffer_hasspace(&recvbuf);
-                if (space > 0)
+                int nread = buffer_readfd(&recvbuf,fd);
+
+                /* read error */
+                if (nread < 0)
                 {
-                    int nread = read(fd,&recvbuf.buffer[recvbuf.in],space);
+                    perror_exit("read error");
+                }
 
-                    /* read error */
-                    if (nread < 0)
+                /* read "FIN" from server */
+                else if (nread == 0)
+                {
+                    /* we have sent "FIN" already */
+                    if (shutdown_flag == 0)
                     {
-                        perror_exit("read error");
+                        printf("server terminates unexpectedly!\n");
+                        exit(EXIT_FAILURE);
                     }
 
-                    /* read "FIN" from server */
-                    else if (nread == 0)
+                    /* the last echoed data goes out before we leave */
+                    while (buffer_hasdata(&recvbuf) > 0)
                     {
-                        /* we have sent "FIN" already */
-                        if (shutdown_flag == 0)
+                        if (buffer_writefd(&recvbuf,STDOUT_FILENO) < 0 && errno != EAGAIN && errno != EINTR)
                         {
-                            printf("server terminates unexpectedly!\n");
-                            exit(EXIT_FAILURE);
+                            perror_exit("write error");
                         }
-                        else
-                            return;
-                    }
-
-                    else
-                    {
-                        recvbuf.in += nread;
-
-                        /* add STDOUT_FILENO to epoll set */
-                        delete_epoll_event(epollfd,connfd,EPOLLIN);
-                        add_epoll_event(epollfd,STDOUT_FILENO,EPOLLOUT);
                     }
+                    return;
                 }
             }
 
             if (fd == STDOUT_FILENO && (events[i].events & EPOLLOUT) )
             {
-                int ntotal = strlen(recvbuf.buffer);
-
-                int nwrite = write(fd,&recvbuf.buffer[recvbuf.out],ntotal);
-
-                if (nwrite < 0)
+                if (buffer_writefd(&recvbuf,fd) < 0)
                 {
                     if (errno != EAGAIN)
                     {
                         perror_exit("write error");
                     }
                 }
-
-                else
-                {
-                    recvbuf.out += ntotal;
-
-                    /* all data has been sent to STANDARD OUTPUT, reset
-                     * the buffer space */
-                    if (recvbuf.in == recvbuf.out)
-                    {
-                        buffer_reset(&recvbuf);
-
-                        delete_epoll_event(epollfd,STDOUT_FILENO,EPOLLOUT);
-                    }
-                }
             }
         }
-    }
-}
-
-/* add_epoll_event: add an @fd into @epollfd set
- * @epollfd: the epoll set the fd added into
- * @fd: the fd to be added into the epoll set
- * @state: the related event of the fd to be add
- *
- * */
-void add_epoll_event(int epollfd, int fd, int state)
-{
-    struct epoll_event ev;
-    ev.events = state;
-    ev.data.fd = fd;
-    if (epoll_ctl(epollfd,EPOLL_CTL_ADD,fd,&ev) < 0 )
-    {
-        perror_exit("epoll control error");
-    }
-}
 
-/* modify_epoll_event: modify an @fd in the @epollfd set
- * @epollfd: the epoll set the fd belongs to
- * @fd: the fd to be modified in the epoll set
- * @state: the related event of fd the to be modified
- *
- * */
-void modify_epoll_event(int epollfd, int fd, int state)
-{
-    struct epoll_event ev;
-    ev.events = state;
-    ev.data.fd = fd;
-    if (epoll_ctl(epollfd,EPOLL_CTL_MOD,fd,&ev) < 0 )
-    {
-        perror_exit("epoll control error");
-    }
-}
-
-/* delete_epoll_event: delete an @fd from @epollfd set
- * @epollfd: the epoll set the fd to be deleted from
- * @fd: the fd to be deleted in the epoll set
- * @state: the related event of the fd to be deleted
- *
- * */
-void delete_epoll_event(int epollfd, int fd, int state)
-{
-    struct epoll_event ev;
-    ev.events = state;
-    ev.data.fd = fd;
-    if (epoll_ctl(epollfd,EPOLL_CTL_DEL,fd,&ev) < 0 )
-    {
-        perror_exit("epoll control error");
+        /* all data typed before "ctrl+d" has been sent, send "FIN" */
+        if (stdin_eof && !shutdown_flag && buffer_hasdata(&sendbuf) == 0)
+        {
+            shutdown_flag = 1;
+            shutdown(connfd,SHUT_WR);
+        }
     }
 }
 
-/* setnonblock: set the non-blocking @fd
- * @fd: the fd to be set
- *
- * */
-void setnonblock(int fd)
-{
-    int opt;
-    /* get the orignal option */
-    if ( (opt = fcntl(fd,F_GETFL)) < 0 )
-    {
-        perror_exit("fctl error");
-    }
-
-    /* set non-block option */
-    opt |= O_NONBLOCK;
-    if ( fcntl(fd,F_SETFL, opt) < 0 )
-    {
-        perror_exit("fcntl error");
-    }
-}
@@ -1,10 +1,13 @@
 #ifndef  SOCK_UTIL_H
 #define  SOCK_UTIL_H
 
+#define   _GNU_SOURCE
+
 #include  <stdio.h>
 #include  <stdlib.h>
 #include  <string.h>
 #include  <errno.h>
+#include  <time.h>
 
 #include  <fcntl.h>
 #include  <signal.h>
@@ -17,45 +20,150 @@
 #include  <arpa/inet.h>
 
 #include  <sys/epoll.h>
+#include  <linux/errqueue.h>
 
 #include  "tool.h"
+#include  "net_util.h"
 #include  "buffer_util.h"
-
-
-/* create and bind the socket */
-int bind_sock(int port);
-
-/* listen the socket */
-void listen_sock(int listenfd);
+#include  "conn_util.h"
+#include  "proto_util.h"
+#include  "frame_util.h"
+#include  "hist_util.h"
+#include  "log_util.h"
+#include  "timer_util.h"
+
+/* the options of the server, set before the reactors start
+ * .proto: the protocol run on the connections
+ * .frame: the length header and the largest payload of the framed protocols
+ * .splice: echo through a pipe with splice() instead of the buffers, the
+ * echo protocol only
+ * .zerocopy: send with MSG_ZEROCOPY when this many bytes are queued, 0 never
+ * .idle_timeout: close a connection without any traffic for this many ms
+ * .read_timeout: close a connection not sending for this many ms
+ * .write_timeout: close a connection not taking its pending output for this
+ * many ms
+ * a timeout of 0 never expires
+ * .report: log the counters of every loop this often, in ms, 0 never
+ * .backlog: the backlog of the listen sockets
+ *
+ * */
+typedef struct server_conf
+{
+    const proto_t *proto;
+    frame_codec_t frame;
+    int splice;
+    int zerocopy;
+    int idle_timeout;
+    int read_timeout;
+    int write_timeout;
+    int report;
+    int backlog;
+}server_conf_t;
+
+extern server_conf_t server_conf;
+
+/* the counters of one event loop, only the loop writes them, with relaxed
+ * stores and no read-modify-write, other threads sum them with relaxed
+ * loads. aligned to a cache line so two loops never share one
+ * .accepts/.closes: the connections accepted and closed
+ * .bytes_in/.bytes_out: the bytes read from and written to the clients
+ * .eagain_read/.eagain_write: the reads and writes that would block
+ * .partial_writes: the writes that left data queued for the next EPOLLOUT
+ * .writes: the write system calls, the ones that would block included
+ * .flushes: the connections the flush passes wrote out
+ * .timeouts: the connections closed by a timeout
+ * .wakeups: the returns of epoll_wait
+ * .events: the events those returns reported
+ *
+ * */
+typedef struct loop_counters
+{
+    unsigned long long accepts;
+    unsigned long long closes;
+    unsigned long long bytes_in;
+    unsigned long long bytes_out;
+    unsigned long long eagain_read;
+    unsigned long long eagain_write;
+    unsigned long long partial_writes;
+    unsigned long long writes;
+    unsigned long long flushes;
+    unsigned long long timeouts;
+    unsigned long long wakeups;
+    unsigned long long events;
+}__attribute__((aligned(64))) loop_counters_t;
+
+/* add @n to a counter owned by the calling loop */
+#define   counter_add(counters,field,n) \
+    __atomic_store_n(&(counters)->field,(counters)->field + (n),__ATOMIC_RELAXED)
+
+/* read a counter of any loop */
+#define   counter_get(counters,field) \
+    __atomic_load_n(&(counters)->field,__ATOMIC_RELAXED)
+
+/* the statistics of one event loop, read by other threads while the loop
+ * records them
+ * .id: the index of the loop
+ * .counters: the counters
+ * .reported: the counters as the loop last logged them
+ * the timings, in ns:
+ * .service: the time do_io takes per event
+ * .wake: the time from epoll_wait returning to the event being dispatched
+ * .first_byte: the time from accept to the first EPOLLIN of a connection
+ *
+ * */
+typedef struct loop_stats
+{
+    int id;
+    loop_counters_t counters;
+    loop_counters_t reported;
+    hist_t service;
+    hist_t wake;
+    hist_t first_byte;
+}loop_stats_t;
 
 /* handle the connected clients */
-void handle_connection(int listenfd);
+void handle_connection(int listenfd, loop_stats_t *stats);
         
 /* add new connection to the server */
-void do_accept(int listenfd, int epollfd);
+int do_accept(int listenfd, int epollfd, conn_table_t *table);
 
-/* read the whole data from fd */
-void do_read(int fd, int epollfd, buffer_t *buf);
+/* read and dispatch the input of the connection until it would block */
+void do_io(conn_t *conn, conn_table_t *table);
 
-/* write the data into the fd */
-void do_write(int fd, int epollfd, buffer_t *buf);
+/* write out the output queued for the connection */
+void do_flush(conn_t *conn, conn_table_t *table);
 
-/* show the client information: ip address and port */
-void show_peer_info(int connfd);
+/* flush the connections on the dirty list */
+void do_flush_pass(conn_table_t *table);
 
-/* client handle the info received from both server and standard input */
-void client_info(int connfd);
+/* read the available data from the connection */
+int do_read(conn_t *conn);
+
+/* pass the data read from the connection to the protocol */
+int do_dispatch(conn_t *conn);
 
-/* add an fd into epoll set */
-void add_epoll_event(int epollfd, int fd, int state);
+/* write the pending data into the connection */
+int do_write(conn_t *conn);
 
-/* modify an fd in epoll set */
-void modify_epoll_event(int epollfd, int fd, int state);
+/* reap the zero copy completions of the connection */
+int do_zerocopy_reap(conn_t *conn);
 
-/* delete an fd in epoll set */
-void delete_epoll_event(int epollfd, int fd, int state);
+/* echo the data of the connection through its pipe */
+int do_splice(conn_t *conn, int *nin, int *nout);
 
-/* set the non-blocking fd */
-void setnonblock(int fd);
+/* the tick the connection times out at, -1 if no timeout applies */
+long long conn_deadline(const conn_t *conn);
+
+/* re-arm the timer of the connection if its deadline moved earlier */
+void conn_rearm(conn_t *conn, conn_table_t *table);
+
+/* the wheel calls it for a connection whose timer expired */
+void conn_expire(wheel_timer_t *timer, void *arg);
+
+/* close the connection */
+void do_close(conn_t *conn, conn_table_t *table);
+
+/* client handle the info received from both server and standard input */
+void client_info(int connfd);
 
 #endif  /*SOCK_UTIL_H*/
@@ -0,0 +1,210 @@
+#include  "timer_util.h"
+#include  "sock_util.h"
+
+#include  <assert.h>
+#include  <sys/timerfd.h>
+
+/* sched_swap: exchange two tasks of the heap, keeping their index */
+static void sched_swap(sched_t *sched, int i, int j)
+{
+    sched_task_t *task = sched->heap[i];
+    sched->heap[i] = sched->heap[j];
+    sched->heap[j] = task;
+    sched->heap[i]->index = i;
+    sched->heap[j]->index = j;
+}
+
+/* sched_up: move the task at @i up until its parent is not later */
+static void sched_up(sched_t *sched, int i)
+{
+    while (i > 0 && sched->heap[(i - 1) / 2]->when > sched->heap[i]->when)
+    {
+        sched_swap(sched,i,(i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+/* sched_down: move the task at @i down until no child is earlier */
+static void sched_down(sched_t *sched, int i)
+{
+    while ( 1 )
+    {
+        int min = i, child = 2 * i + 1;
+        if (child < sched->ntasks && sched->heap[child]->when < sched->heap[min]->when)
+        {
+            min = child;
+        }
+        if (child + 1 < sched->ntasks && sched->heap[child + 1]->when < sched->heap[min]->when)
+        {
+            min = child + 1;
+        }
+        if (min == i)
+        {
+            break;
+        }
+        sched_swap(sched,i,min);
+        i = min;
+    }
+}
+
+/* sched_arm: set the timerfd to the earliest task, the system call is only
+ * made when that time changes */
+static void sched_arm(sched_t *sched)
+{
+    long long when = sched->ntasks > 0 ? sched->heap[0]->when : 0;
+    struct itimerspec its;
+
+    if (when == sched->armed)
+    {
+        return;
+    }
+
+    /* an absolute time of 0 would disarm the timer instead */
+    memset(&its,0,sizeof(its));
+    if (sched->ntasks > 0 && when <= 0)
+    {
+        when = 1;
+    }
+    its.it_value.tv_sec = when / 1000000000LL;
+    its.it_value.tv_nsec = when % 1000000000LL;
+    if (timerfd_settime(sched->fd,TFD_TIMER_ABSTIME,&its,NULL) < 0)
+    {
+        perror_exit("timerfd settime error");
+    }
+    sched->armed = when;
+}
+
+/* sched_init: create the timerfd of the loop, on the same clock as now_ns
+ * @sched: the scheduler
+ * @epollfd: the epoll set of the loop
+ *
+ * */
+void sched_init(sched_t *sched, int epollfd)
+{
+    if ( (sched->fd = timerfd_create(CLOCK_MONOTONIC,TFD_NONBLOCK | TFD_CLOEXEC)) < 0 )
+    {
+        perror_exit("timerfd create error");
+    }
+    sched->armed = 0;
+    sched->heap = NULL;
+    sched->ntasks = sched->maxtasks = 0;
+
+    add_epoll_event(epollfd,sched->fd,EPOLLIN);
+}
+
+/* sched_task_init: initialize a task that is not scheduled
+ * @task: the task
+ *
+ * */
+void sched_task_init(sched_task_t *task)
+{
+    memset(task,0,sizeof(sched_task_t));
+    task->index = -1;
+}
+
+/* sched_add: schedule @task, moving it if it is already scheduled
+ * @sched: the scheduler
+ * @task: the task
+ * @delay: the ns until its first run
+ * @period: the ns between its runs, 0 to run it once
+ * @fn: the callback
+ * @arg: passed to @fn
+ *
+ * */
+void sched_add(sched_t *sched, sched_task_t *task, long long delay, long long period,
+               sched_fn fn, void *arg)
+{
+    sched_cancel(sched,task);
+
+    task->when = now_ns() + delay;
+    task->period = period;
+    task->fn = fn;
+    task->arg = arg;
+
+    if (sched->ntasks == sched->maxtasks)
+    {
+        sched->maxtasks = sched->maxtasks ? sched->maxtasks * 2 : 16;
+        sched->heap = realloc(sched->heap,sched->maxtasks * sizeof(sched_task_t *));
+        assert(sched->heap);
+    }
+    task->index = sched->ntasks++;
+    sched->heap[task->index] = task;
+    sched_up(sched,task->index);
+
+    sched_arm(sched);
+}
+
+/* sched_cancel: unschedule @task, nothing happens if it is not scheduled
+ * @sched: the scheduler
+ * @task: the task
+ *
+ * */
+void sched_cancel(sched_t *sched, sched_task_t *task)
+{
+    int i = task->index;
+
+    if (i < 0)
+    {
+        return;
+    }
+
+    sched->ntasks--;
+    if (i != sched->ntasks)
+    {
+        sched_swap(sched,i,sched->ntasks);
+        sched_down(sched,i);
+        sched_up(sched,i);
+    }
+    task->index = -1;
+
+    sched_arm(sched);
+}
+
+/* sched_run: run every task that is due, a periodic task is scheduled again
+ * one period after the run it was due for, or one period from now if the
+ * loop fell behind by more than a period. a task may add or cancel tasks,
+ * itself included
+ * @sched: the scheduler
+ *
+ * */
+void sched_run(sched_t *sched)
+{
+    unsigned long long expirations;
+
+    /* the timerfd stays readable until it is read */
+    if (read(sched->fd,&expirations,sizeof(expirations)) < 0 && errno != EAGAIN)
+    {
+        perror_exit("timerfd read error");
+    }
+    sched->armed = 0;
+
+    long long now = now_ns();
+    while (sched->ntasks > 0 && sched->heap[0]->when <= now)
+    {
+        sched_task_t *task = sched->heap[0];
+
+        if (task->period > 0)
+        {
+            task->when += task->period;
+            if (task->when <= now)
+            {
+                task->when = now + task->period;
+            }
+            sched_down(sched,0);
+        }
+        else
+        {
+            sched->ntasks--;
+            if (sched->ntasks > 0)
+            {
+                sched_swap(sched,0,sched->ntasks);
+                sched_down(sched,0);
+            }
+            task->index = -1;
+        }
+
+        task->fn(task->arg);
+    }
+
+    sched_arm(sched);
+}
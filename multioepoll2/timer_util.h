@@ -0,0 +1,57 @@
+#ifndef  TIMER_UTIL_H
+#define  TIMER_UTIL_H
+
+/* the function a task runs */
+typedef void (*sched_fn)(void *arg);
+
+/* sched_task: a deferred or periodic callback, kept by its owner
+ * .when: the monotonic time it runs at next, in ns
+ * .period: the ns between two runs, 0 for a task that runs once
+ * .fn/.arg: the callback and its argument
+ * .index: its position in the heap, -1 if it is not scheduled
+ *
+ * */
+typedef struct sched_task
+{
+    long long when;
+    long long period;
+    sched_fn fn;
+    void *arg;
+    int index;
+}sched_task_t;
+
+/* sched: the tasks of one event loop in a min-heap on their time, behind a
+ * single timerfd in the epoll set of the loop, so the loop runs them
+ * without any thread of its own
+ * .fd: the timerfd, readable once the earliest task is due
+ * .armed: the time the timerfd is set to, 0 if it is disarmed
+ * .heap/.ntasks/.maxtasks: the scheduled tasks, the earliest first
+ *
+ * */
+typedef struct sched
+{
+    int fd;
+    long long armed;
+    sched_task_t **heap;
+    int ntasks;
+    int maxtasks;
+}sched_t;
+
+/* create the timerfd and add it to @epollfd */
+void sched_init(sched_t *sched, int epollfd);
+
+/* initialize a task that is not scheduled */
+void sched_task_init(sched_task_t *task);
+
+/* run @fn in @delay ns, then every @period ns if @period is not 0, a task
+ * already scheduled is moved */
+void sched_add(sched_t *sched, sched_task_t *task, long long delay, long long period,
+               sched_fn fn, void *arg);
+
+/* unschedule @task if it is scheduled */
+void sched_cancel(sched_t *sched, sched_task_t *task);
+
+/* run the tasks that are due, called when the timerfd is readable */
+void sched_run(sched_t *sched);
+
+#endif  /*TIMER_UTIL_H*/
@@ -9,11 +9,25 @@
                                   } while(0);
 
 #define   MAXLINE      1024
-#define   LISTENQ      5
+/* the listen backlog when somaxconn cannot be read */
+#define   LISTENQ      SOMAXCONN
 #define   OPENMAX      1000
 #define   INFTIM       -1
 
 #define   EPOLL_SIZE   100
 #define   EPOLL_EVENTS 1000
 
+/* the most connections accepted per wakeup */
+#define   ACCEPT_BATCH     64
+
+/* stop echoing a client once this much output is queued for it */
+#define   CHAIN_HIGHWAT    256*1024
+
+/* the most data held in the pipe of a spliced connection, the default pipe
+ * capacity */
+#define   PIPE_SIZE        64*1024
+
+/* how often the idle pipes nobody took are closed, in ms */
+#define   PIPE_TRIM_MS     10000
+
 #endif  /*TOOL_H*/
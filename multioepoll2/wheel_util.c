@@ -0,0 +1,208 @@
+#include  "wheel_util.h"
+
+#define   WHEEL_MASK       (WHEEL_SLOTS - 1)
+
+/* the span of the whole wheel, later timers are clamped to it */
+#define   WHEEL_SPAN       (1LL << (WHEEL_BITS * WHEEL_LEVELS))
+
+/* wheel_link: put @timer at the end of the list of @head */
+static void wheel_link(wheel_timer_t *head, wheel_timer_t *timer)
+{
+    timer->prev = head->prev;
+    timer->next = head;
+    head->prev->next = timer;
+    head->prev = timer;
+}
+
+/* wheel_unlink: take @timer out of its list */
+static void wheel_unlink(wheel_timer_t *timer)
+{
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+    timer->next = timer->prev = NULL;
+}
+
+/* wheel_place: link @timer into the slot of its expiry, the lowest level
+ * whose span still reaches it */
+static void wheel_place(wheel_t *wheel, wheel_timer_t *timer)
+{
+    long long diff = timer->expire - wheel->now;
+    int level;
+
+    for (level = 0; level < WHEEL_LEVELS - 1; ++level)
+    {
+        if (diff < (1LL << (WHEEL_BITS * (level + 1))))
+        {
+            break;
+        }
+    }
+
+    int slot = (timer->expire >> (WHEEL_BITS * level)) & WHEEL_MASK;
+    wheel_link(&wheel->slots[level][slot],timer);
+}
+
+/* wheel_cascade: move the timers of one slot of @level down, the slot the
+ * current tick has just reached */
+static void wheel_cascade(wheel_t *wheel, int level)
+{
+    int slot = (wheel->now >> (WHEEL_BITS * level)) & WHEEL_MASK;
+    wheel_timer_t *head = &wheel->slots[level][slot];
+
+    while (head->next != head)
+    {
+        wheel_timer_t *timer = head->next;
+        wheel_unlink(timer);
+        wheel_place(wheel,timer);
+    }
+}
+
+/* wheel_init: initialize an empty wheel
+ * @wheel: the wheel
+ * @now: the current tick
+ *
+ * */
+void wheel_init(wheel_t *wheel, long long now)
+{
+    int level, slot;
+
+    wheel->now = now;
+    wheel->count = 0;
+    for (level = 0; level < WHEEL_LEVELS; ++level)
+    {
+        for (slot = 0; slot < WHEEL_SLOTS; ++slot)
+        {
+            wheel->slots[level][slot].next = &wheel->slots[level][slot];
+            wheel->slots[level][slot].prev = &wheel->slots[level][slot];
+        }
+    }
+}
+
+/* wheel_timer_init: initialize a timer that is not armed
+ * @timer: the timer
+ *
+ * */
+void wheel_timer_init(wheel_timer_t *timer)
+{
+    timer->next = timer->prev = NULL;
+    timer->expire = 0;
+}
+
+/* wheel_add: arm @timer, a timer already armed is moved
+ * @wheel: the wheel
+ * @timer: the timer
+ * @expire: the tick it expires at, a past tick expires at the next one
+ *
+ * */
+void wheel_add(wheel_t *wheel, wheel_timer_t *timer, long long expire)
+{
+    wheel_del(wheel,timer);
+
+    if (expire <= wheel->now)
+    {
+        expire = wheel->now + 1;
+    }
+    if (expire - wheel->now >= WHEEL_SPAN)
+    {
+        expire = wheel->now + WHEEL_SPAN - 1;
+    }
+
+    timer->expire = expire;
+    wheel_place(wheel,timer);
+    wheel->count++;
+}
+
+/* wheel_del: disarm @timer, nothing happens if it is not armed
+ * @wheel: the wheel
+ * @timer: the timer
+ *
+ * */
+void wheel_del(wheel_t *wheel, wheel_timer_t *timer)
+{
+    if (timer->next)
+    {
+        wheel_unlink(timer);
+        wheel->count--;
+    }
+}
+
+/* wheel_advance: process every tick up to @now, @fn may re-arm or free the
+ * timer it is called for
+ * @wheel: the wheel
+ * @now: the current tick
+ * @fn: called for each expired timer, after it has been disarmed
+ * @arg: passed to @fn
+ *
+ * */
+void wheel_advance(wheel_t *wheel, long long now, wheel_fn fn, void *arg)
+{
+    int level;
+
+    /* nothing can expire, jump */
+    if (wheel->count == 0 && now > wheel->now)
+    {
+        wheel->now = now;
+        return;
+    }
+
+    while (wheel->now < now)
+    {
+        wheel->now++;
+
+        /* a level wrapping around brings the next slot of the level above
+         * down, the highest level first */
+        for (level = 1; level < WHEEL_LEVELS; ++level)
+        {
+            if (wheel->now & ((1LL << (WHEEL_BITS * level)) - 1))
+            {
+                break;
+            }
+        }
+        while (--level > 0)
+        {
+            wheel_cascade(wheel,level);
+        }
+
+        wheel_timer_t *head = &wheel->slots[0][wheel->now & WHEEL_MASK];
+        while (head->next != head)
+        {
+            wheel_timer_t *timer = head->next;
+            wheel_unlink(timer);
+            wheel->count--;
+            fn(timer,arg);
+        }
+
+        if (wheel->count == 0)
+        {
+            wheel->now = now;
+        }
+    }
+}
+
+/* wheel_timeout: the ticks until the next timer of the lowest level
+ * expires, or until that level wraps around and a cascade may bring
+ * earlier timers down, whichever comes first
+ * @wheel: the wheel
+ *
+ * return the ticks, -1 if no timer is armed
+ *
+ * */
+int wheel_timeout(const wheel_t *wheel)
+{
+    int i;
+
+    if (wheel->count == 0)
+    {
+        return -1;
+    }
+
+    int wrap = WHEEL_SLOTS - (wheel->now & WHEEL_MASK);
+    for (i = 1; i < wrap; ++i)
+    {
+        const wheel_timer_t *head = &wheel->slots[0][(wheel->now + i) & WHEEL_MASK];
+        if (head->next != head)
+        {
+            return i;
+        }
+    }
+    return wrap;
+}
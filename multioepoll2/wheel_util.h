@@ -0,0 +1,61 @@
+#ifndef  WHEEL_UTIL_H
+#define  WHEEL_UTIL_H
+
+#include  <stddef.h>
+
+/* the slots of a level are 2^WHEEL_BITS, every level covers WHEEL_SLOTS
+ * times the span of the level below, four levels of 64 slots of 1 ms reach
+ * about 4.6 hours */
+#define   WHEEL_BITS       6
+#define   WHEEL_SLOTS      (1 << WHEEL_BITS)
+#define   WHEEL_LEVELS     4
+
+/* wheel_timer: a timer, kept in the structure it times
+ * .next/.prev: the neighbours in its slot, NULL if it is not armed
+ * .expire: the tick it expires at
+ *
+ * */
+typedef struct wheel_timer
+{
+    struct wheel_timer *next;
+    struct wheel_timer *prev;
+    long long expire;
+}wheel_timer_t;
+
+/* wheel: a hierarchical timing wheel with a tick of 1 ms, adding, deleting
+ * and expiring a timer are O(1), a timer only moves down a level when the
+ * level below wraps around
+ * .now: the last tick processed
+ * .count: the number of armed timers
+ * .slots: the list heads of the slots of each level
+ *
+ * */
+typedef struct wheel
+{
+    long long now;
+    int count;
+    wheel_timer_t slots[WHEEL_LEVELS][WHEEL_SLOTS];
+}wheel_t;
+
+/* the function called for each expired timer */
+typedef void (*wheel_fn)(wheel_timer_t *timer, void *arg);
+
+/* initialize an empty wheel starting at tick @now */
+void wheel_init(wheel_t *wheel, long long now);
+
+/* initialize a timer that is not armed */
+void wheel_timer_init(wheel_timer_t *timer);
+
+/* arm @timer to expire at tick @expire, re-arming it if it is armed */
+void wheel_add(wheel_t *wheel, wheel_timer_t *timer, long long expire);
+
+/* disarm @timer if it is armed */
+void wheel_del(wheel_t *wheel, wheel_timer_t *timer);
+
+/* process the ticks up to @now, calling @fn for every timer expiring */
+void wheel_advance(wheel_t *wheel, long long now, wheel_fn fn, void *arg);
+
+/* the ticks until the wheel has to be advanced again, -1 if it is empty */
+int wheel_timeout(const wheel_t *wheel);
+
+#endif  /*WHEEL_UTIL_H*/
@@ -12,22 +12,69 @@
  *        3. type the combo keys "ctrl+d" meaning "EOF" by client will cause
  *        the client and server to close the connection.
  *
+ *        4. the number of clients is only bounded by the open files limit,
+ *        the server raises its soft limit to the hard one (ulimit -Hn) at
+ *        startup.
+ *
+ *        5. -b <#backlog> sets the listen backlog, the completed
+ *        connections the kernel queues until they are accepted (default:
+ *        /proc/sys/net/core/somaxconn, which also caps it).
+ *        example: ./server -b 1024 9899
+ *
+ *        6. -e <#backend> runs the loop on another netcore backend, select,
+ *        poll, epoll or uring (default: poll), so the backends can be
+ *        compared on the same server. the loop is echo_serve of netcore,
+ *        the one multioselect runs as well.
+ *        example: ./server -e epoll 9899
+ *
  *        */
 
+static void usage(void)
+{
+    printf("usage: ./server [-b #backlog] [-e %s] <#port>\n",
+           event_backend_names());
+    exit(EXIT_FAILURE);
+}
+
 int main(int argc, char *argv[])
 {
-    if (argc != 2)
+    const event_backend_t *backend = &event_poll;
+    int backlog = default_backlog();
+    int opt;
+
+    while ( (opt = getopt(argc,argv,"b:e:")) != -1 )
+    {
+        switch (opt)
+        {
+            case 'b':
+                backlog = atoi(optarg);
+                break;
+            case 'e':
+                if ( (backend = event_backend_find(optarg)) == NULL )
+                {
+                    usage();
+                }
+                break;
+            default:
+                usage();
+        }
+    }
+
+    if (optind != argc - 1 || backlog <= 0)
     {
-        printf("usage: ./server <#port>\n");
-        exit(EXIT_FAILURE);
+        usage();
     }
-    int port = atoi(argv[1]);
+    int port = atoi(argv[optind]);
+
+    raise_nofile();
+
+    log_init(STDOUT_FILENO,LOG_INFO);
 
-    int listenfd = bind_sock(port);
+    int listenfd = bind_sock(port,0);
 
-    listen_sock(listenfd);
+    listen_sock(listenfd,backlog);
 
-    handle_connection(listenfd);
+    echo_serve(listenfd,backend);
 
     return 0;
 }
@@ -18,20 +18,12 @@
 #include  <poll.h>
 
 #include  "tool.h"
+#include  "net_util.h"
+#include  "log_util.h"
+#include  "event_util.h"
+#include  "echo_util.h"
 
 
-/* create and bind the socket */
-int bind_sock(int port);
-
-/* listen the socket */
-void listen_sock(int listenfd);
-
-/* handle the connected clients */
-void handle_connection(int listenfd);
-        
-/* show the client information: ip address and port */
-void show_peer_info(int connfd);
-
 /* client handle the info received from both server and standard input */
 void client_info(int connfd);
 
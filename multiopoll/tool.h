@@ -9,8 +9,6 @@
                                   } while(0);
 
 #define   MAXLINE      1024
-#define   LISTENQ      5
-#define   OPENMAX      1000
 #define   INFTIM       -1
 
 #endif  /*TOOL_H*/
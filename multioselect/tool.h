@@ -9,6 +9,5 @@
                                   } while(0);
 
 #define   MAXLINE      1024
-#define   LISTENQ      5
 
 #endif  /*TOOL_H*/
@@ -0,0 +1,65 @@
+#include  "sock_util.h"
+
+/* howto: 1. run the command: ./server <#port>, which makes the server listen
+ *        on the specific #port. and then run: ./client <#ipaddr> <#port>
+ *        so that the client is connecting to the server.
+ *        example: ./server 9899
+ *                 ./client 127.0.0.1 9899
+ *
+ *        2. type anything from the client and then the server will echo
+ *        whatever it received from the clients.
+ *
+ *        3. type the combo keys "ctrl+d" meaning "EOF" by client will cause
+ *        the client and server to close the connection.
+ *
+ *        the server is driven by io_uring instead of epoll: a few accepts
+ *        in flight, each returning the client address, one multishot recv
+ *        per connection into a ring of provided buffers, and the echo sent
+ *        back from those buffers as linked sends.
+ *
+ *        4. -b <#backlog> sets the listen backlog, the completed
+ *        connections the kernel queues until they are accepted (default:
+ *        /proc/sys/net/core/somaxconn, which also caps it).
+ *        example: ./server -b 1024 9899
+ *
+ *        */
+
+static void usage(void)
+{
+    printf("usage: ./server [-b #backlog] <#port>\n");
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+    int backlog = default_backlog();
+    int opt;
+
+    while ( (opt = getopt(argc,argv,"b:")) != -1 )
+    {
+        switch (opt)
+        {
+            case 'b':
+                backlog = atoi(optarg);
+                break;
+            default:
+                usage();
+        }
+    }
+
+    if (optind != argc - 1 || backlog <= 0)
+    {
+        usage();
+    }
+    int port = atoi(argv[optind]);
+
+    log_init(STDOUT_FILENO,LOG_INFO);
+
+    int listenfd = bind_sock(port,0);
+
+    listen_sock(listenfd,backlog);
+
+    handle_connection(listenfd);
+
+    return 0;
+}
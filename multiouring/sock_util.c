@@ -0,0 +1,515 @@
+#include  "sock_util.h"
+
+/* the kinds of request, kept in the upper half of the user data */
+#define   UD_ACCEPT    1
+#define   UD_RECV      2
+#define   UD_SEND      3
+#define   UD_CANCEL    4
+
+#define   UD_MAKE(type,fd)   (((unsigned long long)(type) << 32) | (unsigned int)(fd))
+#define   UD_TYPE(ud)        ((int)((ud) >> 32))
+#define   UD_FD(ud)          ((int)((ud) & 0xffffffff))
+
+/* the most sends linked into one chain */
+#define   SEND_CHAIN   16
+
+/* uring_conn: the state kept for each connected client
+ * .active: the fd is a connection of the server
+ * .recving: the multishot recv is armed
+ * .eof: no more data will be received, "FIN" or error
+ * .broken: a send failed, the connection is shutting down
+ * .starved: the recv stopped for lack of buffers and waits to be re-armed
+ * .throttled: the recv stopped because URING_CONN_BUFS buffers are queued,
+ *  on_send re-arms it once half of them are sent
+ * .nqueued: the number of buffers waiting to be echoed
+ * .inflight: the number of sends of the current chain not completed yet
+ * .head/.tail: the received buffers waiting to be echoed, linked through
+ *  the .next array of the server
+ *
+ * */
+typedef struct uring_conn
+{
+    int active;
+    int recving;
+    int eof;
+    int broken;
+    int starved;
+    int throttled;
+    int nqueued;
+    int inflight;
+    int head;
+    int tail;
+}uring_conn_t;
+
+/* uring_server: the state of the io_uring server
+ * .ring: the ring all requests go through
+ * .listenfd: the socket the accepts are made on
+ * .addrs/.addrlens: the client address of each accept in flight
+ * .bufs: the provided buffers multishot recv picks from
+ * .next/.off/.len: the echo queue link, send offset and length of each buffer
+ * .conns/.nconns: the connections indexed by fd
+ * .starved/.nstarved: the connections whose recv waits for buffers
+ * .recycled: buffers have been given back since the last re-arm pass
+ *
+ * */
+typedef struct uring_server
+{
+    uring_t ring;
+    int listenfd;
+    struct sockaddr_in addrs[ACCEPT_SLOTS];
+    socklen_t addrlens[ACCEPT_SLOTS];
+    uring_bufring_t bufs;
+    int next[URING_NBUFS];
+    int off[URING_NBUFS];
+    int len[URING_NBUFS];
+    uring_conn_t *conns;
+    int nconns;
+    int *starved;
+    int nstarved;
+    int recycled;
+}uring_server_t;
+
+/* get_conn: the connection of @fd, the table grows to hold any fd */
+static uring_conn_t *get_conn(uring_server_t *srv, int fd)
+{
+    if (fd >= srv->nconns)
+    {
+        int size = srv->nconns ? srv->nconns : 1024;
+        while (fd >= size)
+        {
+            size *= 2;
+        }
+
+        srv->conns = realloc(srv->conns,size * sizeof(uring_conn_t));
+        srv->starved = realloc(srv->starved,size * sizeof(int));
+        if (srv->conns == NULL || srv->starved == NULL)
+        {
+            perror_exit("realloc error");
+        }
+        memset(srv->conns + srv->nconns,0,(size - srv->nconns) * sizeof(uring_conn_t));
+        srv->nconns = size;
+    }
+    return &srv->conns[fd];
+}
+
+/* arm_accept: start the accept of slot @slot, the slot is kept in the user
+ * data in place of the fd */
+static void arm_accept(uring_server_t *srv, int slot)
+{
+    struct io_uring_sqe *sqe = uring_get_sqe(&srv->ring);
+    srv->addrlens[slot] = sizeof(struct sockaddr_in);
+    uring_prep_accept(sqe,srv->listenfd,(struct sockaddr *)&srv->addrs[slot],&srv->addrlens[slot]);
+    sqe->user_data = UD_MAKE(UD_ACCEPT,slot);
+}
+
+/* arm_recv: start the multishot recv of @fd */
+static void arm_recv(uring_server_t *srv, int fd)
+{
+    struct io_uring_sqe *sqe = uring_get_sqe(&srv->ring);
+    uring_prep_recv_multishot(sqe,fd,srv->bufs.bgid);
+    sqe->user_data = UD_MAKE(UD_RECV,fd);
+    srv->conns[fd].recving = 1;
+}
+
+/* pace_recv: re-arm the recv of @fd unless it is still armed, waits for
+ * buffers, or too much of its echo is queued */
+static void pace_recv(uring_server_t *srv, int fd)
+{
+    uring_conn_t *conn = &srv->conns[fd];
+
+    if (conn->recving || conn->starved || conn->eof || conn->broken)
+    {
+        return;
+    }
+    if (conn->throttled && conn->nqueued > URING_CONN_BUFS / 2)
+    {
+        return;
+    }
+    conn->throttled = 0;
+    arm_recv(srv,fd);
+}
+
+/* throttle_recv: stop the recv of @fd, the client is not reading its echo
+ * as fast as it sends. the recv still completes the chunks in progress and
+ * then terminates with -ECANCELED */
+static void throttle_recv(uring_server_t *srv, int fd)
+{
+    uring_conn_t *conn = &srv->conns[fd];
+
+    conn->throttled = 1;
+    if (conn->recving)
+    {
+        struct io_uring_sqe *sqe = uring_get_sqe(&srv->ring);
+        uring_prep_cancel(sqe,UD_MAKE(UD_RECV,fd));
+        sqe->user_data = UD_MAKE(UD_CANCEL,fd);
+    }
+}
+
+/* recycle_buf: give buffer @bid back to the kernel */
+static void recycle_buf(uring_server_t *srv, int bid)
+{
+    uring_bufring_add(&srv->bufs,bid);
+    srv->recycled = 1;
+}
+
+/* send_chain: send the queued buffers of @fd as one linked chain, the link
+ * keeps them in order and the whole chain costs a single submission
+ *
+ * */
+static void send_chain(uring_server_t *srv, int fd)
+{
+    uring_conn_t *conn = &srv->conns[fd];
+    int bid, n = 0;
+
+    for (bid = conn->head; bid >= 0 && n < SEND_CHAIN; bid = srv->next[bid])
+    {
+        struct io_uring_sqe *sqe = uring_get_sqe(&srv->ring);
+        uring_prep_send(sqe,fd,uring_bufring_buf(&srv->bufs,bid) + srv->off[bid],srv->len[bid],MSG_WAITALL | MSG_NOSIGNAL);
+        sqe->user_data = UD_MAKE(UD_SEND,fd);
+        if (srv->next[bid] >= 0 && n < SEND_CHAIN - 1)
+        {
+            sqe->flags |= IOSQE_IO_LINK;
+        }
+        n++;
+    }
+    conn->inflight = n;
+}
+
+/* try_close: close @fd once no request refers to it any more */
+static void try_close(uring_server_t *srv, int fd)
+{
+    uring_conn_t *conn = &srv->conns[fd];
+
+    if ( !(conn->eof || conn->broken) || conn->recving || conn->starved || conn->inflight > 0 )
+    {
+        return;
+    }
+
+    /* the client is gone, its pending echo is dropped */
+    if (conn->broken)
+    {
+        while (conn->head >= 0)
+        {
+            int bid = conn->head;
+            conn->head = srv->next[bid];
+            conn->nqueued--;
+            recycle_buf(srv,bid);
+        }
+    }
+
+    if (conn->head < 0)
+    {
+        close(fd);
+        conn->active = 0;
+    }
+}
+
+/* on_accept: the accept of slot @slot has completed, the client address
+ * came with it so no getpeername is needed */
+static void on_accept(uring_server_t *srv, int slot, int res)
+{
+    if (res >= 0)
+    {
+        log_addr_info(&srv->addrs[slot]);
+
+        uring_conn_t *conn = get_conn(srv,res);
+        memset(conn,0,sizeof(uring_conn_t));
+        conn->active = 1;
+        conn->head = conn->tail = -1;
+
+        arm_recv(srv,res);
+    }
+    else if (res != -EAGAIN && res != -ECONNABORTED && res != -EINTR)
+    {
+        errno = -res;
+        perror("accept error");
+    }
+
+    /* the slot takes the next connection */
+    arm_accept(srv,slot);
+}
+
+/* on_recv: data, "FIN" or an error has been received on @fd */
+static void on_recv(uring_server_t *srv, int fd, int res, unsigned flags)
+{
+    uring_conn_t *conn = &srv->conns[fd];
+
+    if (res > 0)
+    {
+        /* queue the buffer to be echoed as it is, no copy */
+        int bid = flags >> IORING_CQE_BUFFER_SHIFT;
+        srv->off[bid] = 0;
+        srv->len[bid] = res;
+        srv->next[bid] = -1;
+        if (conn->tail >= 0)
+        {
+            srv->next[conn->tail] = bid;
+        }
+        else
+        {
+            conn->head = bid;
+        }
+        conn->tail = bid;
+        conn->nqueued++;
+
+        if (conn->inflight == 0 && !conn->broken)
+        {
+            send_chain(srv,fd);
+        }
+        if (conn->nqueued >= URING_CONN_BUFS && !conn->throttled)
+        {
+            throttle_recv(srv,fd);
+        }
+    }
+    else if (res != -ENOBUFS && res != -ECANCELED)
+    {
+        /* read "FIN" from client or the connection is broken */
+        conn->eof = 1;
+    }
+
+    if ( !(flags & IORING_CQE_F_MORE) )
+    {
+        conn->recving = 0;
+
+        /* out of buffers, wait until some are given back. a throttled
+         * recv waits for its own echo instead */
+        if (res == -ENOBUFS && !conn->throttled && !conn->eof && !conn->broken)
+        {
+            conn->starved = 1;
+            srv->starved[srv->nstarved++] = fd;
+        }
+        else
+        {
+            pace_recv(srv,fd);
+        }
+    }
+
+    try_close(srv,fd);
+}
+
+/* on_send: a send of the chain of @fd has completed */
+static void on_send(uring_server_t *srv, int fd, int res)
+{
+    uring_conn_t *conn = &srv->conns[fd];
+    int bid = conn->head;
+
+    conn->inflight--;
+
+    /* the rest of a broken chain is cancelled and stays queued */
+    if (res == -ECANCELED)
+    {
+    }
+    else if (res < 0)
+    {
+        conn->broken = 1;
+    }
+    else
+    {
+        srv->off[bid] += res;
+        srv->len[bid] -= res;
+        if (srv->len[bid] == 0)
+        {
+            conn->head = srv->next[bid];
+            if (conn->head < 0)
+            {
+                conn->tail = -1;
+            }
+            conn->nqueued--;
+            recycle_buf(srv,bid);
+        }
+    }
+
+    if (conn->inflight == 0)
+    {
+        if (conn->broken)
+        {
+            /* wake the multishot recv up so that it terminates */
+            if (conn->recving)
+            {
+                shutdown(fd,SHUT_RDWR);
+            }
+        }
+        else if (conn->head >= 0)
+        {
+            send_chain(srv,fd);
+        }
+    }
+
+    /* enough of the echo has gone out to take more data again */
+    if (conn->throttled)
+    {
+        pace_recv(srv,fd);
+    }
+
+    try_close(srv,fd);
+}
+
+/* handle_connection: handle the connected clients with io_uring, ACCEPT_SLOTS
+ * accepts stay in flight and the recv is multishot so one submission keeps
+ * serving a client, the received buffers are echoed straight from the
+ * provided buffer ring
+ * @listenfd: the socket used to accept connections
+ *
+ * */
+void handle_connection(int listenfd)
+{
+    uring_server_t *srv = calloc(1,sizeof(uring_server_t));
+    if (srv == NULL)
+    {
+        perror_exit("calloc error");
+    }
+
+    uring_init(&srv->ring,URING_ENTRIES);
+    uring_bufring_init(&srv->ring,&srv->bufs,URING_NBUFS,URING_BUFSIZE,0);
+
+    srv->listenfd = listenfd;
+    int slot;
+    for (slot = 0; slot < ACCEPT_SLOTS; ++slot)
+    {
+        arm_accept(srv,slot);
+    }
+
+    while( 1 )
+    {
+        /* submit the new requests and wait for a completion in one call */
+        uring_submit_and_wait(&srv->ring,1);
+
+        struct io_uring_cqe *cqe;
+        while ( (cqe = uring_peek_cqe(&srv->ring)) != NULL )
+        {
+            unsigned long long ud = cqe->user_data;
+            int res = cqe->res;
+            unsigned flags = cqe->flags;
+            uring_cqe_seen(&srv->ring);
+
+            switch (UD_TYPE(ud))
+            {
+                case UD_ACCEPT:
+                    on_accept(srv,UD_FD(ud),res);
+                    break;
+                case UD_RECV:
+                    on_recv(srv,UD_FD(ud),res,flags);
+                    break;
+                case UD_SEND:
+                    on_send(srv,UD_FD(ud),res);
+                    break;
+                case UD_CANCEL:
+                    /* the recv itself reports how it ended */
+                    break;
+            }
+        }
+
+        /* publish the buffers echoed in this round, then restart the recvs
+         * that ran out of them */
+        if (srv->recycled)
+        {
+            uring_bufring_commit(&srv->bufs);
+            srv->recycled = 0;
+
+            while (srv->nstarved > 0)
+            {
+                int fd = srv->starved[--srv->nstarved];
+                srv->conns[fd].starved = 0;
+                if (srv->conns[fd].eof || srv->conns[fd].broken)
+                {
+                    try_close(srv,fd);
+                }
+                else
+                {
+                    pace_recv(srv,fd);
+                }
+            }
+        }
+    }
+}
+
+
+/* client handle the info received from both server and standard input
+ * @connfd: the connected socket used for communication
+ *
+ */
+void client_info(int connfd)
+{
+    int m, n;
+    char sendline[MAXLINE], recvline[MAXLINE];
+
+    /* shutdown flag indicates if close the connection is normal */
+    int shutdown_flag = 0;
+
+    /* fd set monitors conncted socket fd and standard input, if either one is
+     * readable, then we obtain the info from it*/
+    fd_set rset;
+    FD_ZERO(&rset);
+
+    int maxfd = (connfd > STDIN_FILENO ? connfd : STDIN_FILENO);
+
+    while( 1 )
+    {
+        FD_SET(connfd, &rset);
+        FD_SET(STDIN_FILENO, &rset);
+        if (select(maxfd+1,&rset,NULL,NULL,NULL) < 0 )
+        {
+            perror("select error");
+        }
+
+        /* socket readable: socket --> standard output */
+        if (FD_ISSET(connfd, &rset))
+        {
+            /* read "FIN" from socket */
+            if ((n = read(connfd,recvline,MAXLINE)) == 0)
+            {
+                /* server terminates unexpectedly, since we haven't sent "FIN"
+                 * yet */
+                if (shutdown_flag == 0)
+                {
+                    printf("server terminates unexpectedly!\n");
+                    exit(EXIT_FAILURE);
+                }
+                return;
+            }
+            else
+            {
+                /* write the echoed info to standard output */
+                if (write(STDOUT_FILENO,recvline,n) < 0)
+                {
+                    perror("write error");
+                }
+            }
+        }
+
+        /* standard input readable: standard input --> socket */
+        if (FD_ISSET(STDIN_FILENO, &rset))
+        {
+            if ( (m = read(STDIN_FILENO,sendline,MAXLINE)) < 0 )
+            {
+                /* read is interrupted by signal stuff */
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                else
+                {
+                    perror_exit("read error");
+                }
+            }
+
+            /* read "EOF" from standard input, send a "FIN" */
+            else if (m == 0)
+            {
+                shutdown(connfd,SHUT_WR);
+                /* set the flag to 1 to indicate that we have sent the "FIN" flag */
+                shutdown_flag = 1;
+                FD_CLR(STDIN_FILENO, &rset);
+            }
+
+            /* write the line to the socket */
+            else
+            {
+                if (write(connfd,sendline,m) < 0)
+                {
+                    perror_exit("write error");
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef  SOCK_UTIL_H
+#define  SOCK_UTIL_H
+
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  <errno.h>
+
+#include  <signal.h>
+
+#include  <unistd.h>
+#include  <sys/socket.h>
+#include  <sys/wait.h>
+#include  <sys/types.h>
+#include  <netinet/in.h>
+#include  <arpa/inet.h>
+
+#include  "tool.h"
+#include  "net_util.h"
+#include  "log_util.h"
+#include  "uring_util.h"
+
+
+/* handle the connected clients */
+void handle_connection(int listenfd);
+
+/* client handle the info received from both server and standard input */
+void client_info(int connfd);
+
+#endif  /*SOCK_UTIL_H*/
@@ -0,0 +1,28 @@
+#ifndef  TOOL_H
+#define  TOOL_H
+
+#include  <stdio.h>
+#include  <errno.h>
+
+#define   perror_exit(strinfo)    do { perror(strinfo); \
+                                       exit(EXIT_FAILURE); \
+                                  } while(0);
+
+#define   MAXLINE      1024
+
+/* the number of submission queue entries of the ring */
+#define   URING_ENTRIES    4096
+
+/* the provided buffers the kernel picks from for multishot recv */
+#define   URING_NBUFS      4096
+#define   URING_BUFSIZE    4*1024
+
+/* the buffers one connection may hold waiting for its echo (256K), above
+ * it the recv is stopped until half of them are sent, so a client not
+ * reading its echo cannot take the buffers of all the others */
+#define   URING_CONN_BUFS  64
+
+/* the accepts kept in flight, each with an address slot of its own */
+#define   ACCEPT_SLOTS     16
+
+#endif  /*TOOL_H*/
@@ -0,0 +1,77 @@
+#include  "echo_util.h"
+#include  "net_util.h"
+#include  "tool.h"
+
+#include  <unistd.h>
+#include  <arpa/inet.h>
+
+/* echo_serve: accept the clients and echo what they send, all on one loop
+ * of @backend. none of the backends is bounded by FD_SETSIZE or OPENMAX,
+ * only by the open files limit
+ * @listenfd: the socket used to accept connections
+ * @backend: the netcore backend the loop runs on
+ *
+ * */
+void echo_serve(int listenfd, const event_backend_t *backend)
+{
+    event_loop_t loop;
+    event_loop_init(&loop,backend);
+    event_add(&loop,listenfd,EV_READ);
+
+    /* the ready fds of one wait */
+    event_t events[ECHO_EVENTS];
+    int nready;
+
+    int connfd;
+    struct sockaddr_in clitaddr;
+    socklen_t socklen;
+
+    int i;
+
+    char recvline[ECHO_LINE];
+    int n;
+
+    while( 1 )
+    {
+        nready = event_wait(&loop,events,ECHO_EVENTS,-1);
+
+        for (i = 0; i < nready; ++i)
+        {
+            int fd = events[i].fd;
+
+            if (fd == listenfd)
+            {
+                socklen = sizeof(struct sockaddr_in);
+                if ( (connfd = accept(listenfd,(struct sockaddr *)&clitaddr,&socklen)) < 0)
+                {
+                    /* out of fds or the client gave up, the others still go on */
+                    if (errno != EINTR && errno != ECONNABORTED && errno != EMFILE && errno != ENFILE)
+                    {
+                        perror_exit("accept error");
+                    }
+                }
+                else
+                {
+                    event_add(&loop,connfd,EV_READ);
+
+                    log_addr_info(&clitaddr);
+                }
+                continue;
+            }
+
+            if ((n = read(fd,recvline,ECHO_LINE)) <= 0)
+            {
+                /* read "FIN" or an error from client */
+                event_del(&loop,fd);
+                close(fd);
+            }
+            else
+            {
+                if (write(fd,recvline,n) < 0)
+                {
+                    perror_exit("write error");
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,16 @@
+#ifndef  ECHO_UTIL_H
+#define  ECHO_UTIL_H
+
+#include  "event_util.h"
+
+/* the most ready fds one wait reports */
+#define   ECHO_EVENTS      1000
+
+/* the bytes read and echoed at once */
+#define   ECHO_LINE        1024
+
+/* the echo server of the event loop models, accept and echo on one loop,
+ * the models only differ in the backend @backend */
+void echo_serve(int listenfd, const event_backend_t *backend);
+
+#endif  /*ECHO_UTIL_H*/
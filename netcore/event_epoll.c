@@ -0,0 +1,98 @@
+#include  "event_util.h"
+#include  "net_util.h"
+#include  "tool.h"
+
+#include  <assert.h>
+#include  <unistd.h>
+#include  <sys/epoll.h>
+
+/* epoll_state: the epoll set and the array epoll_wait fills
+ * .epollfd: the epoll set
+ * .evs/.maxevs: the array and its size, grown to the largest wait
+ *
+ * */
+typedef struct epoll_state
+{
+    int epollfd;
+    struct epoll_event *evs;
+    int maxevs;
+}epoll_state_t;
+
+/* epoll_mask: the epoll events of EV_* @events, level triggered */
+static int epoll_mask(int events)
+{
+    return ((events & EV_READ) ? EPOLLIN : 0) | ((events & EV_WRITE) ? EPOLLOUT : 0);
+}
+
+static void *epoll_create_state(void)
+{
+    epoll_state_t *st = calloc(1,sizeof(epoll_state_t));
+    assert(st);
+
+    if ( (st->epollfd = epoll_create1(EPOLL_CLOEXEC)) < 0 )
+    {
+        perror_exit("epoll create error");
+    }
+
+    return st;
+}
+
+static void epoll_add(void *state, int fd, int events)
+{
+    add_epoll_event(((epoll_state_t *)state)->epollfd,fd,epoll_mask(events));
+}
+
+static void epoll_mod(void *state, int fd, int events)
+{
+    modify_epoll_event(((epoll_state_t *)state)->epollfd,fd,epoll_mask(events));
+}
+
+static void epoll_del(void *state, int fd)
+{
+    delete_epoll_event(((epoll_state_t *)state)->epollfd,fd,0);
+}
+
+static int epoll_wait_events(void *state, event_t *events, int maxevents, int timeout)
+{
+    epoll_state_t *st = state;
+    int i;
+
+    if (maxevents > st->maxevs)
+    {
+        st->maxevs = maxevents;
+        st->evs = realloc(st->evs,st->maxevs * sizeof(struct epoll_event));
+        assert(st->evs);
+    }
+
+    int n = epoll_wait(st->epollfd,st->evs,maxevents,timeout);
+    for (i = 0; i < n; ++i)
+    {
+        unsigned revents = st->evs[i].events;
+        events[i].fd = st->evs[i].data.fd;
+        events[i].events = ((revents & EPOLLIN) ? EV_READ : 0) |
+                           ((revents & EPOLLOUT) ? EV_WRITE : 0) |
+                           ((revents & (EPOLLERR | EPOLLHUP)) ? EV_ERROR : 0);
+    }
+
+    return n;
+}
+
+static void epoll_destroy(void *state)
+{
+    epoll_state_t *st = state;
+
+    close(st->epollfd);
+    free(st->evs);
+    free(st);
+}
+
+const event_backend_t event_epoll =
+{
+    "epoll",
+    epoll_create_state,
+    epoll_add,
+    epoll_mod,
+    epoll_del,
+    epoll_wait_events,
+    epoll_destroy,
+};
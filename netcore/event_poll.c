@@ -0,0 +1,165 @@
+#include  "event_util.h"
+#include  "tool.h"
+
+#include  <assert.h>
+#include  <poll.h>
+
+/* the initial number of entries of both arrays */
+#define   POLL_SIZE        1024
+
+/* poll_state: the fds poll watches, kept packed at the front of the array
+ * so poll never walks holes, with the index of each fd to find it again in
+ * O(1)
+ * .fds/.nfds/.maxfds: the pollfd array, its used and allocated entries
+ * .slots/.nslots: the index in .fds of each fd, -1 if it is not watched
+ *
+ * */
+typedef struct poll_state
+{
+    struct pollfd *fds;
+    int nfds;
+    int maxfds;
+    int *slots;
+    int nslots;
+}poll_state_t;
+
+/* poll_mask: the poll events of EV_* @events */
+static short poll_mask(int events)
+{
+    return ((events & EV_READ) ? POLLIN : 0) | ((events & EV_WRITE) ? POLLOUT : 0);
+}
+
+static void *poll_create(void)
+{
+    poll_state_t *st = calloc(1,sizeof(poll_state_t));
+    int i;
+    assert(st);
+
+    st->maxfds = st->nslots = POLL_SIZE;
+    st->fds = malloc(st->maxfds * sizeof(struct pollfd));
+    st->slots = malloc(st->nslots * sizeof(int));
+    assert(st->fds && st->slots);
+
+    for (i = 0; i < st->nslots; ++i)
+    {
+        st->slots[i] = -1;
+    }
+
+    return st;
+}
+
+/* poll_add: append @fd to the pollfd array, growing the arrays if they are
+ * full or @fd is past the slots */
+static void poll_add(void *state, int fd, int events)
+{
+    poll_state_t *st = state;
+
+    if (st->nfds == st->maxfds)
+    {
+        st->maxfds *= 2;
+        st->fds = realloc(st->fds,st->maxfds * sizeof(struct pollfd));
+        assert(st->fds);
+    }
+
+    if (fd >= st->nslots)
+    {
+        int size = st->nslots, i;
+        while (size <= fd)
+        {
+            size *= 2;
+        }
+        st->slots = realloc(st->slots,size * sizeof(int));
+        assert(st->slots);
+        for (i = st->nslots; i < size; ++i)
+        {
+            st->slots[i] = -1;
+        }
+        st->nslots = size;
+    }
+
+    int index = st->nfds++;
+    st->fds[index].fd = fd;
+    st->fds[index].events = poll_mask(events);
+    st->fds[index].revents = 0;
+    st->slots[fd] = index;
+}
+
+static void poll_mod(void *state, int fd, int events)
+{
+    poll_state_t *st = state;
+
+    if (fd >= 0 && fd < st->nslots && st->slots[fd] >= 0)
+    {
+        st->fds[st->slots[fd]].events = poll_mask(events);
+    }
+}
+
+/* poll_del: remove @fd by moving the last entry into its place, so the
+ * array stays packed */
+static void poll_del(void *state, int fd)
+{
+    poll_state_t *st = state;
+
+    if (fd < 0 || fd >= st->nslots || st->slots[fd] < 0)
+    {
+        return;
+    }
+
+    int index = st->slots[fd];
+    int last = --st->nfds;
+    if (index != last)
+    {
+        st->fds[index] = st->fds[last];
+        st->slots[st->fds[index].fd] = index;
+    }
+    st->slots[fd] = -1;
+}
+
+static int poll_wait(void *state, event_t *events, int maxevents, int timeout)
+{
+    poll_state_t *st = state;
+    int i, n = 0;
+
+    int nready = poll(st->fds,st->nfds,timeout);
+    if (nready <= 0)
+    {
+        return nready;
+    }
+
+    for (i = 0; i < st->nfds && n < nready && n < maxevents; ++i)
+    {
+        short revents = st->fds[i].revents;
+        if (revents == 0)
+        {
+            continue;
+        }
+
+        events[n].fd = st->fds[i].fd;
+        events[n].events = ((revents & POLLIN) ? EV_READ : 0) |
+                           ((revents & POLLOUT) ? EV_WRITE : 0) |
+                           ((revents & (POLLERR | POLLHUP | POLLNVAL)) ? EV_ERROR : 0);
+        ++n;
+    }
+
+    return n;
+}
+
+static void poll_destroy(void *state)
+{
+    poll_state_t *st = state;
+
+    free(st->fds);
+    free(st->slots);
+    free(st);
+}
+
+const event_backend_t event_poll =
+{
+    "poll",
+    poll_create,
+    poll_add,
+    poll_mod,
+    poll_del,
+    poll_wait,
+    poll_destroy,
+};
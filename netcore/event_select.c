@@ -0,0 +1,170 @@
+#include  "event_util.h"
+#include  "tool.h"
+
+#include  <string.h>
+#include  <assert.h>
+#include  <sys/select.h>
+
+/* the fds the bitmaps cover at first, they grow past FD_SETSIZE, linux's
+ * select takes any number of bits */
+#define   SELECT_SIZE      1024
+
+/* select_state: the bitmaps of the watched fds and the copies select
+ * overwrites, sized to the highest fd instead of FD_SETSIZE
+ * .rall/.wall: the fds watched for reading and writing
+ * .rset/.wset: the copies passed to select
+ * .nwords: the words in each bitmap
+ * .maxfd: the highest fd watched, -1 if none
+ *
+ * */
+typedef struct select_state
+{
+    fd_mask *rall;
+    fd_mask *wall;
+    fd_mask *rset;
+    fd_mask *wset;
+    int nwords;
+    int maxfd;
+}select_state_t;
+
+static void *select_create(void)
+{
+    select_state_t *st = calloc(1,sizeof(select_state_t));
+    assert(st);
+
+    st->nwords = SELECT_SIZE / NFDBITS;
+    st->rall = calloc(st->nwords,sizeof(fd_mask));
+    st->wall = calloc(st->nwords,sizeof(fd_mask));
+    st->rset = calloc(st->nwords,sizeof(fd_mask));
+    st->wset = calloc(st->nwords,sizeof(fd_mask));
+    assert(st->rall && st->wall && st->rset && st->wset);
+    st->maxfd = -1;
+
+    return st;
+}
+
+/* select_grow: make the bitmaps cover @fd */
+static void select_grow(select_state_t *st, int fd)
+{
+    int nwords = st->nwords;
+
+    while (nwords <= fd / NFDBITS)
+    {
+        nwords *= 2;
+    }
+    st->rall = realloc(st->rall,nwords * sizeof(fd_mask));
+    st->wall = realloc(st->wall,nwords * sizeof(fd_mask));
+    st->rset = realloc(st->rset,nwords * sizeof(fd_mask));
+    st->wset = realloc(st->wset,nwords * sizeof(fd_mask));
+    assert(st->rall && st->wall && st->rset && st->wset);
+    memset(st->rall + st->nwords,0,(nwords - st->nwords) * sizeof(fd_mask));
+    memset(st->wall + st->nwords,0,(nwords - st->nwords) * sizeof(fd_mask));
+    st->nwords = nwords;
+}
+
+static void select_mod(void *state, int fd, int events)
+{
+    select_state_t *st = state;
+    fd_mask bit = (fd_mask)1 << (fd % NFDBITS);
+    int word = fd / NFDBITS;
+
+    if (word >= st->nwords)
+    {
+        select_grow(st,fd);
+    }
+
+    st->rall[word] = (events & EV_READ) ? (st->rall[word] | bit) : (st->rall[word] & ~bit);
+    st->wall[word] = (events & EV_WRITE) ? (st->wall[word] | bit) : (st->wall[word] & ~bit);
+
+    if (events && fd > st->maxfd)
+    {
+        st->maxfd = fd;
+    }
+
+    /* the highest fd is found again by walking down the words */
+    if (events == 0 && fd == st->maxfd)
+    {
+        while (word >= 0 && (st->rall[word] | st->wall[word]) == 0)
+        {
+            --word;
+        }
+        st->maxfd = word < 0 ? -1
+            : word * NFDBITS + (NFDBITS - 1 - __builtin_clzl((unsigned long)(st->rall[word] | st->wall[word])));
+    }
+}
+
+static void select_add(void *state, int fd, int events)
+{
+    select_mod(state,fd,events);
+}
+
+static void select_del(void *state, int fd)
+{
+    select_mod(state,fd,0);
+}
+
+/* select_wait: only the words up to the highest fd are copied and walked,
+ * a whole word without a ready fd is skipped at once */
+static int select_wait(void *state, event_t *events, int maxevents, int timeout)
+{
+    select_state_t *st = state;
+    int nwords = st->maxfd / NFDBITS + 1;
+    int word, n = 0;
+    struct timeval tv, *tvp = NULL;
+
+    if (timeout >= 0)
+    {
+        tv.tv_sec = timeout / 1000;
+        tv.tv_usec = (timeout % 1000) * 1000;
+        tvp = &tv;
+    }
+
+    memcpy(st->rset,st->rall,nwords * sizeof(fd_mask));
+    memcpy(st->wset,st->wall,nwords * sizeof(fd_mask));
+
+    int nready = select(st->maxfd + 1,(fd_set *)st->rset,(fd_set *)st->wset,NULL,tvp);
+    if (nready <= 0)
+    {
+        return nready;
+    }
+
+    for (word = 0; word < nwords && n < maxevents; ++word)
+    {
+        unsigned long bits = st->rset[word] | st->wset[word];
+        while (bits && n < maxevents)
+        {
+            int bit = __builtin_ctzl(bits);
+            bits &= bits - 1;
+
+            int fd = word * NFDBITS + bit;
+            events[n].fd = fd;
+            events[n].events = ((st->rset[word] >> bit) & 1 ? EV_READ : 0) |
+                               ((st->wset[word] >> bit) & 1 ? EV_WRITE : 0);
+            ++n;
+        }
+    }
+
+    return n;
+}
+
+static void select_destroy(void *state)
+{
+    select_state_t *st = state;
+
+    free(st->rall);
+    free(st->wall);
+    free(st->rset);
+    free(st->wset);
+    free(st);
+}
+
+const event_backend_t event_select =
+{
+    "select",
+    select_create,
+    select_add,
+    select_mod,
+    select_del,
+    select_wait,
+    select_destroy,
+};
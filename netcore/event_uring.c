@@ -0,0 +1,243 @@
+#include  "event_util.h"
+#include  "uring_util.h"
+#include  "tool.h"
+
+#include  <assert.h>
+#include  <poll.h>
+
+/* the submission entries of the ring */
+#define   URING_ENTRIES    4096
+
+/* the initial number of fds the tables cover */
+#define   URING_SIZE       1024
+
+/* the user data of a poll request is the fd and its generation, so the
+ * completion of a request made before the fd was modified, deleted or
+ * reused is told apart and dropped */
+#define   UD_POLL(fd,gen)      (((unsigned long long)(gen) << 32) | (unsigned)(fd))
+#define   UD_FD(ud)            ((int)((ud) & 0xffffffff))
+#define   UD_GEN(ud)           ((unsigned)((ud) >> 32))
+
+/* the user data of the other requests, never a poll's, as fds are below
+ * 2^31 */
+#define   UD_TIMEOUT           0xffffffffffffffffULL
+#define   UD_REMOVE            0xfffffffffffffffeULL
+
+/* uring_state: readiness on io_uring, a one-shot poll request per watched
+ * fd, made again after each completion, which gives the level triggered
+ * behaviour of the other backends
+ * .ring: the ring
+ * .events/.gens/.armed: per fd, the EV_* watched, the generation of its
+ * poll request and whether that request is in flight
+ * .size: the fds the tables cover
+ * .rearm/.nrearm: the fds reported by the last wait, polled again by the
+ * next one, after the caller has served them
+ * .ts: the timeout of the last wait
+ * .timeouts: the timeout requests in flight, one left over by an earlier
+ * wait completes before the one of the current wait
+ *
+ * */
+typedef struct uring_state
+{
+    uring_t ring;
+    int *events;
+    unsigned *gens;
+    char *armed;
+    int size;
+    int *rearm;
+    int nrearm;
+    struct __kernel_timespec ts;
+    int timeouts;
+}uring_state_t;
+
+/* uring_poll_mask: the poll events of EV_* @events */
+static unsigned uring_poll_mask(int events)
+{
+    return ((events & EV_READ) ? POLLIN : 0) | ((events & EV_WRITE) ? POLLOUT : 0);
+}
+
+static void *uring_create(void)
+{
+    uring_state_t *st = calloc(1,sizeof(uring_state_t));
+    assert(st);
+
+    uring_init(&st->ring,URING_ENTRIES);
+
+    st->size = URING_SIZE;
+    st->events = calloc(st->size,sizeof(int));
+    st->gens = calloc(st->size,sizeof(unsigned));
+    st->armed = calloc(st->size,sizeof(char));
+    st->rearm = malloc(st->size * sizeof(int));
+    assert(st->events && st->gens && st->armed && st->rearm);
+
+    return st;
+}
+
+/* uring_grow: make the tables cover @fd */
+static void uring_grow(uring_state_t *st, int fd)
+{
+    int size = st->size;
+
+    while (size <= fd)
+    {
+        size *= 2;
+    }
+    st->events = realloc(st->events,size * sizeof(int));
+    st->gens = realloc(st->gens,size * sizeof(unsigned));
+    st->armed = realloc(st->armed,size * sizeof(char));
+    st->rearm = realloc(st->rearm,size * sizeof(int));
+    assert(st->events && st->gens && st->armed && st->rearm);
+    memset(st->events + st->size,0,(size - st->size) * sizeof(int));
+    memset(st->gens + st->size,0,(size - st->size) * sizeof(unsigned));
+    memset(st->armed + st->size,0,(size - st->size) * sizeof(char));
+    st->size = size;
+}
+
+/* uring_arm: queue a poll request for @fd, submitted by the next wait */
+static void uring_arm(uring_state_t *st, int fd)
+{
+    struct io_uring_sqe *sqe = uring_get_sqe(&st->ring);
+    uring_prep_poll_add(sqe,fd,uring_poll_mask(st->events[fd]));
+    sqe->user_data = UD_POLL(fd,st->gens[fd]);
+    st->armed[fd] = 1;
+}
+
+/* uring_disarm: cancel the poll request of @fd if one is in flight, its
+ * completion is dropped by the generation */
+static void uring_disarm(uring_state_t *st, int fd)
+{
+    if (st->armed[fd])
+    {
+        struct io_uring_sqe *sqe = uring_get_sqe(&st->ring);
+        uring_prep_poll_remove(sqe,UD_POLL(fd,st->gens[fd]));
+        sqe->user_data = UD_REMOVE;
+        st->armed[fd] = 0;
+    }
+    st->gens[fd]++;
+}
+
+static void uring_mod(void *state, int fd, int events)
+{
+    uring_state_t *st = state;
+
+    if (fd >= st->size)
+    {
+        uring_grow(st,fd);
+    }
+
+    uring_disarm(st,fd);
+    st->events[fd] = events;
+    if (events)
+    {
+        uring_arm(st,fd);
+    }
+}
+
+static void uring_add(void *state, int fd, int events)
+{
+    uring_mod(state,fd,events);
+}
+
+static void uring_del(void *state, int fd)
+{
+    uring_mod(state,fd,0);
+}
+
+/* uring_wait: submit the queued requests, with the fds reported last time
+ * polled again, and reap the completions. a timeout request also completes
+ * with the first other completion, so it hardly outlives its wait */
+static int uring_wait(void *state, event_t *events, int maxevents, int timeout)
+{
+    uring_state_t *st = state;
+    struct io_uring_cqe *cqe;
+    int i, n = 0, timedout = 0;
+
+    for (i = 0; i < st->nrearm; ++i)
+    {
+        int fd = st->rearm[i];
+        if (st->events[fd] && !st->armed[fd])
+        {
+            uring_arm(st,fd);
+        }
+    }
+    st->nrearm = 0;
+
+    if (timeout >= 0)
+    {
+        st->ts.tv_sec = timeout / 1000;
+        st->ts.tv_nsec = (timeout % 1000) * 1000000LL;
+        struct io_uring_sqe *sqe = uring_get_sqe(&st->ring);
+        uring_prep_timeout(sqe,&st->ts);
+        sqe->off = 1;
+        sqe->user_data = UD_TIMEOUT;
+        st->timeouts++;
+    }
+
+    while (n == 0 && !timedout)
+    {
+        uring_submit_and_wait(&st->ring,1);
+
+        while ( (cqe = uring_peek_cqe(&st->ring)) != NULL )
+        {
+            unsigned long long ud = cqe->user_data;
+            int res = cqe->res;
+            uring_cqe_seen(&st->ring);
+
+            if (ud == UD_TIMEOUT)
+            {
+                st->timeouts--;
+                timedout = (timeout >= 0 && st->timeouts == 0);
+                continue;
+            }
+            if (ud == UD_REMOVE)
+            {
+                continue;
+            }
+
+            int fd = UD_FD(ud);
+            if (fd >= st->size || UD_GEN(ud) != st->gens[fd] || !st->armed[fd])
+            {
+                continue;
+            }
+            st->armed[fd] = 0;
+            st->rearm[st->nrearm++] = fd;
+
+            /* past @maxevents the fd is polled again and reported by the
+             * next wait */
+            if (n < maxevents)
+            {
+                events[n].fd = fd;
+                events[n].events = res < 0 ? EV_ERROR :
+                                   ((res & POLLIN) ? EV_READ : 0) |
+                                   ((res & POLLOUT) ? EV_WRITE : 0) |
+                                   ((res & (POLLERR | POLLHUP)) ? EV_ERROR : 0);
+                ++n;
+            }
+        }
+    }
+
+    return n;
+}
+
+static void uring_destroy(void *state)
+{
+    uring_state_t *st = state;
+
+    close(st->ring.fd);
+    free(st->events);
+    free(st->gens);
+    free(st->armed);
+    free(st->rearm);
+    free(st);
+}
+
+const event_backend_t event_uring =
+{
+    "uring",
+    uring_create,
+    uring_add,
+    uring_mod,
+    uring_del,
+    uring_wait,
+    uring_destroy,
+};
@@ -0,0 +1,133 @@
+#include  "event_util.h"
+#include  "tool.h"
+
+#include  <string.h>
+
+/* the backends event_backend_find knows, in the order of the usage lines */
+static const event_backend_t *event_backends[] =
+{
+    &event_select,
+    &event_poll,
+    &event_epoll,
+    &event_uring,
+};
+
+#define   EVENT_NBACKENDS  (int)(sizeof(event_backends) / sizeof(event_backends[0]))
+
+/* event_backend_find: look a backend up by its name
+ * @name: select, poll, epoll or uring
+ *
+ * return the backend, NULL if there is none called @name
+ *
+ * */
+const event_backend_t *event_backend_find(const char *name)
+{
+    int i;
+
+    for (i = 0; i < EVENT_NBACKENDS; ++i)
+    {
+        if (strcmp(event_backends[i]->name,name) == 0)
+        {
+            return event_backends[i];
+        }
+    }
+    return NULL;
+}
+
+/* event_backend_names: the names of the backends, e.g. "select|poll"
+ *
+ * */
+const char *event_backend_names(void)
+{
+    static char names[64];
+    int i;
+
+    if (names[0] == '\0')
+    {
+        for (i = 0; i < EVENT_NBACKENDS; ++i)
+        {
+            if (i > 0)
+            {
+                strcat(names,"|");
+            }
+            strcat(names,event_backends[i]->name);
+        }
+    }
+    return names;
+}
+
+/* event_loop_init: start a loop on @backend
+ * @loop: the loop
+ * @backend: the backend
+ *
+ * */
+void event_loop_init(event_loop_t *loop, const event_backend_t *backend)
+{
+    loop->backend = backend;
+    loop->state = backend->create();
+}
+
+/* event_loop_destroy: release the state of the loop
+ * @loop: the loop
+ *
+ * */
+void event_loop_destroy(event_loop_t *loop)
+{
+    loop->backend->destroy(loop->state);
+    loop->state = NULL;
+}
+
+/* event_add: watch @fd for @events
+ * @loop: the loop
+ * @fd: the fd
+ * @events: EV_READ and/or EV_WRITE
+ *
+ * */
+void event_add(event_loop_t *loop, int fd, int events)
+{
+    loop->backend->add(loop->state,fd,events);
+}
+
+/* event_mod: watch @fd for @events instead of its current events
+ * @loop: the loop
+ * @fd: the fd
+ * @events: EV_READ and/or EV_WRITE
+ *
+ * */
+void event_mod(event_loop_t *loop, int fd, int events)
+{
+    loop->backend->mod(loop->state,fd,events);
+}
+
+/* event_del: stop watching @fd, it must still be open
+ * @loop: the loop
+ * @fd: the fd
+ *
+ * */
+void event_del(event_loop_t *loop, int fd)
+{
+    loop->backend->del(loop->state,fd);
+}
+
+/* event_wait: wait until some fds are ready, retrying on EINTR
+ * @loop: the loop
+ * @events: filled with the ready fds
+ * @maxevents: the size of @events
+ * @timeout: the most ms to wait, -1 forever
+ *
+ * return the number of ready fds, 0 on timeout
+ *
+ * */
+int event_wait(event_loop_t *loop, event_t *events, int maxevents, int timeout)
+{
+    int n;
+
+    while ( (n = loop->backend->wait(loop->state,events,maxevents,timeout)) < 0 )
+    {
+        if (errno != EINTR)
+        {
+            perror_exit("event wait error");
+        }
+    }
+    return n;
+}
@@ -0,0 +1,86 @@
+#ifndef  EVENT_UTIL_H
+#define  EVENT_UTIL_H
+
+/* the events of an fd, the same for every backend */
+#define   EV_READ      0x1
+#define   EV_WRITE     0x2
+#define   EV_ERROR     0x4
+
+/* event: an fd reported ready by event_wait
+ * .fd: the fd
+ * .events: the EV_* it is ready for, EV_ERROR for an error or a hangup
+ *
+ * */
+typedef struct event
+{
+    int fd;
+    int events;
+}event_t;
+
+/* event_backend: the calls an event loop is built on, one implementation
+ * per readiness api, all of them level triggered: an fd is reported by
+ * every wait as long as it is ready for the events it is watched for
+ * .name: the name the backend is looked up by
+ * .create: the state of a new loop
+ * .add/.mod/.del: watch an fd, change its events, stop watching it
+ * .wait: fill @events with the ready fds, wait at most @timeout ms, -1
+ * forever, return their number
+ * .destroy: release the state
+ *
+ * the fds given to .add must be below the open files limit, every backend
+ * grows its tables with them
+ *
+ * */
+typedef struct event_backend
+{
+    const char *name;
+    void *(*create)(void);
+    void (*add)(void *state, int fd, int events);
+    void (*mod)(void *state, int fd, int events);
+    void (*del)(void *state, int fd);
+    int (*wait)(void *state, event_t *events, int maxevents, int timeout);
+    void (*destroy)(void *state);
+}event_backend_t;
+
+/* event_loop: a loop on one backend
+ * .backend: the backend
+ * .state: its state
+ *
+ * */
+typedef struct event_loop
+{
+    const event_backend_t *backend;
+    void *state;
+}event_loop_t;
+
+/* the backends */
+extern const event_backend_t event_select;
+extern const event_backend_t event_poll;
+extern const event_backend_t event_epoll;
+extern const event_backend_t event_uring;
+
+/* the backend called @name, NULL if there is none */
+const event_backend_t *event_backend_find(const char *name);
+
+/* the names of the backends, separated by '|', for the usage lines */
+const char *event_backend_names(void);
+
+/* start a loop on @backend */
+void event_loop_init(event_loop_t *loop, const event_backend_t *backend);
+
+/* stop the loop and release its state */
+void event_loop_destroy(event_loop_t *loop);
+
+/* watch @fd for @events */
+void event_add(event_loop_t *loop, int fd, int events);
+
+/* watch @fd for @events instead */
+void event_mod(event_loop_t *loop, int fd, int events);
+
+/* stop watching @fd, before it is closed */
+void event_del(event_loop_t *loop, int fd);
+
+/* wait for the ready fds */
+int event_wait(event_loop_t *loop, event_t *events, int maxevents, int timeout);
+
+#endif  /*EVENT_UTIL_H*/
@@ -0,0 +1,163 @@
+#include  "hist_util.h"
+
+#define   HIST_HALF    (1ULL << (HIST_SUB_BITS - 1))
+
+/* hist_index: the bucket of @value */
+static int hist_index(unsigned long long value)
+{
+    if (value < (1ULL << HIST_SUB_BITS))
+    {
+        return (int)value;
+    }
+
+    /* keep the top HIST_SUB_BITS bits, the shift picks the power of two */
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - HIST_SUB_BITS + 1;
+    return (int)((shift * HIST_HALF) + (value >> shift));
+}
+
+/* hist_upper: the largest value falling in bucket @index */
+static unsigned long long hist_upper(int index)
+{
+    if (index < (1 << HIST_SUB_BITS))
+    {
+        return index;
+    }
+
+    int shift = index / HIST_HALF - 1;
+    unsigned long long mant = index - shift * HIST_HALF;
+    return ((mant + 1) << shift) - 1;
+}
+
+/* hist_init: initialize an empty histogram
+ * @hist: the histogram
+ *
+ * */
+void hist_init(hist_t *hist)
+{
+    memset(hist,0,sizeof(hist_t));
+}
+
+/* hist_record: record @value in O(1), only the owner of @hist may call it,
+ * the increments are plain loads and relaxed stores rather than atomic
+ * read-modify-writes so they cost no more than a normal increment
+ * @hist: the histogram
+ * @value: the value
+ *
+ * */
+void hist_record(hist_t *hist, unsigned long long value)
+{
+    int i = hist_index(value);
+
+    __atomic_store_n(&hist->counts[i],hist->counts[i] + 1,__ATOMIC_RELAXED);
+    __atomic_store_n(&hist->total,hist->total + 1,__ATOMIC_RELAXED);
+    if (value > hist->max)
+    {
+        __atomic_store_n(&hist->max,value,__ATOMIC_RELAXED);
+    }
+}
+
+/* hist_merge: add the counts of @src into @dst, @src may be recording at
+ * the same time in another thread, @dst must not be
+ * @dst: the histogram added into
+ * @src: the histogram added
+ *
+ * */
+void hist_merge(hist_t *dst, const hist_t *src)
+{
+    int i;
+    unsigned long long total = 0;
+
+    for (i = 0; i < HIST_NBUCKETS; ++i)
+    {
+        unsigned long long n = __atomic_load_n(&src->counts[i],__ATOMIC_RELAXED);
+        dst->counts[i] += n;
+        total += n;
+    }
+
+    /* the sum of the buckets read, not src->total, so a merge done while
+     * recording stays consistent with itself */
+    dst->total += total;
+
+    unsigned long long max = __atomic_load_n(&src->max,__ATOMIC_RELAXED);
+    if (max > dst->max)
+    {
+        dst->max = max;
+    }
+}
+
+/* hist_count: the number of values recorded
+ * @hist: the histogram
+ *
+ * */
+unsigned long long hist_count(const hist_t *hist)
+{
+    return __atomic_load_n(&hist->total,__ATOMIC_RELAXED);
+}
+
+/* hist_percentile: the value at percentile @p, reported as the top of its
+ * bucket but never above the largest value recorded
+ * @hist: the histogram
+ * @p: the percentile, 0 - 100
+ *
+ * return the value, 0 if the histogram is empty
+ *
+ * */
+unsigned long long hist_percentile(const hist_t *hist, double p)
+{
+    unsigned long long total = hist_count(hist);
+    unsigned long long max = __atomic_load_n(&hist->max,__ATOMIC_RELAXED);
+    unsigned long long seen = 0;
+    int i;
+
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    /* the rank of the value, at least the first one */
+    unsigned long long rank = (unsigned long long)(p / 100 * total + 0.999999);
+    if (rank == 0)
+    {
+        rank = 1;
+    }
+
+    for (i = 0; i < HIST_NBUCKETS; ++i)
+    {
+        seen += __atomic_load_n(&hist->counts[i],__ATOMIC_RELAXED);
+        if (seen >= rank)
+        {
+            unsigned long long value = hist_upper(i);
+            return value < max ? value : max;
+        }
+    }
+    return max;
+}
+
+/* hist_serialize: write @hist as "<total> <max> <bucket>:<count> ..." with
+ * only the non-empty buckets, the text is cut short if @size is too small
+ * @hist: the histogram
+ * @buf: the buffer written to
+ * @size: the size of @buf
+ *
+ * return the length written
+ *
+ * */
+int hist_serialize(const hist_t *hist, char *buf, int size)
+{
+    int i, len;
+
+    len = snprintf(buf,size,"%llu %llu",hist_count(hist),
+                   __atomic_load_n(&hist->max,__ATOMIC_RELAXED));
+
+    for (i = 0; i < HIST_NBUCKETS && len < size; ++i)
+    {
+        unsigned long long n = __atomic_load_n(&hist->counts[i],__ATOMIC_RELAXED);
+        if (n > 0)
+        {
+            len += snprintf(buf + len,size - len," %d:%llu",i,n);
+        }
+    }
+
+    return len < size ? len : size - 1;
+}
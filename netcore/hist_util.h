@@ -0,0 +1,50 @@
+#ifndef  HIST_UTIL_H
+#define  HIST_UTIL_H
+
+#include  <stdio.h>
+#include  <string.h>
+
+/* the sub-buckets per power of two are 2^(HIST_SUB_BITS - 1), so a value
+ * is kept within 1/32 (about 3%) of itself */
+#define   HIST_SUB_BITS    6
+
+/* the buckets needed to cover every 64-bit value */
+#define   HIST_NBUCKETS    ((64 - HIST_SUB_BITS + 2) << (HIST_SUB_BITS - 1))
+
+/* histogram: a log-linear histogram of fixed size, values below
+ * 2^HIST_SUB_BITS have a bucket each, every power of two above that is
+ * split into the same number of linear buckets
+ * .counts: the count of each bucket
+ * .total: the number of values recorded
+ * .max: the largest value recorded
+ *
+ * a histogram has a single writer, it stores with relaxed atomics so that
+ * other threads can read or merge it at any time without a lock
+ *
+ * */
+typedef struct histogram
+{
+    unsigned long long counts[HIST_NBUCKETS];
+    unsigned long long total;
+    unsigned long long max;
+}hist_t;
+
+/* initialize an empty histogram */
+void hist_init(hist_t *hist);
+
+/* record one value */
+void hist_record(hist_t *hist, unsigned long long value);
+
+/* add the counts of @src into @dst */
+void hist_merge(hist_t *dst, const hist_t *src);
+
+/* the number of values recorded */
+unsigned long long hist_count(const hist_t *hist);
+
+/* the value at percentile @p (0 - 100) */
+unsigned long long hist_percentile(const hist_t *hist, double p);
+
+/* write the non-empty buckets as text, return the length written */
+int hist_serialize(const hist_t *hist, char *buf, int size);
+
+#endif  /*HIST_UTIL_H*/
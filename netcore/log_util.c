@@ -0,0 +1,265 @@
+#define   _GNU_SOURCE
+
+#include  "log_util.h"
+
+#include  <limits.h>
+#include  <sys/uio.h>
+
+int log_level = LOG_INFO;
+
+/* the fd the lines go to, -1 before log_init */
+static int log_fd = -1;
+
+/* the rings of all threads, the lock is only taken when a thread logs for
+ * the first time and once per flush, never per line */
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+static log_ring_t *log_rings;
+
+/* the ring of the calling thread */
+static __thread log_ring_t *log_ring;
+
+static const char *log_names[] = { "error", "warn", "info", "debug" };
+
+/* log_now: the monotonic clock in ns */
+static long long log_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* log_ring_get: the ring of the calling thread, created on its first line */
+static log_ring_t *log_ring_get(void)
+{
+    if (log_ring == NULL)
+    {
+        log_ring_t *ring = aligned_alloc(64,sizeof(log_ring_t));
+        if (ring == NULL)
+        {
+            return NULL;
+        }
+        memset(ring,0,sizeof(log_ring_t));
+        ring->tokens = LOG_RATE;
+        ring->refill = log_now() + 1000000000LL;
+
+        pthread_mutex_lock(&log_lock);
+        ring->next = log_rings;
+        log_rings = ring;
+        pthread_mutex_unlock(&log_lock);
+
+        log_ring = ring;
+    }
+    return log_ring;
+}
+
+/* log_flush_ring: write the lines waiting in @ring with as few writev as
+ * possible, and report the lines dropped since the last flush */
+static void log_flush_ring(log_ring_t *ring)
+{
+    struct iovec iov[IOV_MAX];
+    unsigned head = __atomic_load_n(&ring->head,__ATOMIC_ACQUIRE);
+    unsigned tail = ring->tail;
+
+    while (tail != head)
+    {
+        int n = 0;
+        unsigned i;
+        for (i = tail; i != head && n < IOV_MAX; ++i, ++n)
+        {
+            iov[n].iov_base = ring->lines[i % LOG_RING_SLOTS];
+            iov[n].iov_len = ring->lens[i % LOG_RING_SLOTS];
+        }
+
+        if (writev(log_fd,iov,n) < 0)
+        {
+            break;
+        }
+
+        /* the slots may be reused from now on */
+        tail += n;
+        __atomic_store_n(&ring->tail,tail,__ATOMIC_RELEASE);
+    }
+
+    unsigned long long dropped = __atomic_load_n(&ring->dropped,__ATOMIC_RELAXED);
+    if (dropped != ring->reported)
+    {
+        char line[64];
+        int len = snprintf(line,sizeof(line),"[warn] %llu log lines dropped\n",dropped - ring->reported);
+        if (write(log_fd,line,len) == len)
+        {
+            ring->reported = dropped;
+        }
+    }
+}
+
+/* log_flusher: the background thread writing the lines of every ring out
+ * every LOG_FLUSH_MS
+ * @arg: unused
+ *
+ * */
+static void *log_flusher(void *arg)
+{
+    struct timespec period = { 0, LOG_FLUSH_MS * 1000000L };
+    log_ring_t *ring;
+
+    (void)arg;
+
+    while ( 1 )
+    {
+        nanosleep(&period,NULL);
+
+        /* rings are only ever pushed at the front, the list seen here can
+         * be walked without the lock */
+        pthread_mutex_lock(&log_lock);
+        ring = log_rings;
+        pthread_mutex_unlock(&log_lock);
+
+        for ( ; ring; ring = ring->next)
+        {
+            log_flush_ring(ring);
+        }
+    }
+
+    return NULL;
+}
+
+/* log_prepare: keep the rings from changing hands across a fork */
+static void log_prepare(void)
+{
+    pthread_mutex_lock(&log_lock);
+}
+
+/* log_parent: the fork is over in the parent */
+static void log_parent(void)
+{
+    pthread_mutex_unlock(&log_lock);
+}
+
+/* log_child: the flusher did not survive the fork, and the lines waiting
+ * in the rings are written by the one of the parent. the child starts with
+ * no ring and writes its lines directly until it calls log_init
+ *
+ * */
+static void log_child(void)
+{
+    log_rings = NULL;
+    log_ring = NULL;
+    log_fd = -1;
+    pthread_mutex_unlock(&log_lock);
+}
+
+/* log_init: start the flusher thread
+ * @fd: the fd the lines are written to
+ * @level: the most verbose level kept
+ *
+ * */
+void log_init(int fd, int level)
+{
+    static int forkable;
+    pthread_t tid;
+    sigset_t all, old;
+
+    log_fd = fd;
+    log_level = level;
+
+    /* a forked child inherits the handlers, so they are installed once */
+    if (!forkable)
+    {
+        pthread_atfork(log_prepare,log_parent,log_child);
+        forkable = 1;
+    }
+
+    /* the flusher takes no signal, the ones the server waits for with a
+     * signalfd, SIGUSR1, would otherwise be delivered to it and kill it */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK,&all,&old);
+    if (pthread_create(&tid,NULL,log_flusher,NULL) != 0)
+    {
+        perror("pthread create error");
+        exit(EXIT_FAILURE);
+    }
+    pthread_sigmask(SIG_SETMASK,&old,NULL);
+    pthread_detach(tid);
+}
+
+/* log_refill: refill the tokens of the calling thread, from then on only
+ * this refills them, so it has to be called every second
+ *
+ * */
+void log_refill(void)
+{
+    log_ring_t *ring = log_ring_get();
+    if (ring == NULL)
+    {
+        return;
+    }
+
+    ring->tokens = LOG_RATE;
+    ring->refill = 0;
+}
+
+/* log_msg: format one line into the ring of the calling thread, the
+ * flusher writes it out later. the line is dropped, and counted, if the
+ * thread logs faster than LOG_RATE lines per second or the ring is full
+ * @level: the level of the line
+ * @fmt: the printf format of the line, without the newline
+ *
+ * */
+void log_msg(int level, const char *fmt, ...)
+{
+    va_list ap;
+
+    /* nothing to flush to yet, the line goes out directly */
+    if (log_fd < 0)
+    {
+        va_start(ap,fmt);
+        vfprintf(stderr,fmt,ap);
+        va_end(ap);
+        fputc('\n',stderr);
+        return;
+    }
+
+    log_ring_t *ring = log_ring_get();
+    if (ring == NULL)
+    {
+        return;
+    }
+
+    /* the rate limit, a token bucket refilled once per second, here unless
+     * the thread refills it itself */
+    if (ring->refill > 0)
+    {
+        long long now = log_now();
+        if (now >= ring->refill)
+        {
+            ring->tokens = LOG_RATE;
+            ring->refill = now + 1000000000LL;
+        }
+    }
+
+    unsigned head = ring->head;
+    if (ring->tokens == 0 ||
+        head - __atomic_load_n(&ring->tail,__ATOMIC_ACQUIRE) == LOG_RING_SLOTS)
+    {
+        __atomic_store_n(&ring->dropped,ring->dropped + 1,__ATOMIC_RELAXED);
+        return;
+    }
+    ring->tokens--;
+
+    char *line = ring->lines[head % LOG_RING_SLOTS];
+    int len = snprintf(line,LOG_LINE_MAX,"[%s] ",log_names[level]);
+
+    va_start(ap,fmt);
+    len += vsnprintf(line + len,LOG_LINE_MAX - len,fmt,ap);
+    va_end(ap);
+
+    if (len > LOG_LINE_MAX - 1)
+    {
+        len = LOG_LINE_MAX - 1;
+    }
+    line[len++] = '\n';
+    ring->lens[head % LOG_RING_SLOTS] = len;
+
+    /* publish the line to the flusher */
+    __atomic_store_n(&ring->head,head + 1,__ATOMIC_RELEASE);
+}
@@ -0,0 +1,76 @@
+#ifndef  LOG_UTIL_H
+#define  LOG_UTIL_H
+
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  <stdarg.h>
+#include  <time.h>
+#include  <unistd.h>
+#include  <pthread.h>
+#include  <signal.h>
+
+/* the lines a thread can have waiting for the flusher */
+#define   LOG_RING_SLOTS   1024
+
+/* the longest line, longer ones are cut */
+#define   LOG_LINE_MAX     256
+
+/* the lines a thread may log per second, and at once */
+#define   LOG_RATE         1000
+
+/* how often the flusher writes the lines out, in ms */
+#define   LOG_FLUSH_MS     50
+
+/* the levels, a line is kept if its level is at most log_level */
+#define   LOG_ERROR        0
+#define   LOG_WARN         1
+#define   LOG_INFO         2
+#define   LOG_DEBUG        3
+
+/* log_ring: the lines of one thread waiting to be written, it has a single
+ * producer (the thread) and a single consumer (the flusher), so the ring
+ * needs no lock, only the ordering of the two indexes
+ * .head: the next slot the thread writes, only the thread stores it
+ * .tail: the next slot the flusher reads, only the flusher stores it
+ * .dropped: the lines lost to a full ring or to the rate limit
+ * .tokens: the lines the thread may still log before the next refill
+ * .refill: when the tokens are refilled next, in ns, 0 once log_refill does it
+ * .next: the next ring of the flusher
+ * .lines/.lens: the lines and their lengths
+ *
+ * */
+typedef struct log_ring
+{
+    unsigned head __attribute__((aligned(64)));
+    unsigned long long dropped;
+    int tokens;
+    long long refill;
+    unsigned tail __attribute__((aligned(64)));
+    unsigned long long reported;
+    struct log_ring *next;
+    int lens[LOG_RING_SLOTS];
+    char lines[LOG_RING_SLOTS][LOG_LINE_MAX];
+}log_ring_t;
+
+/* the most verbose level kept */
+extern int log_level;
+
+/* start the flusher writing the lines to @fd, a forked child has no
+ * flusher and writes its lines directly until it calls this itself */
+void log_init(int fd, int level);
+
+/* refill the rate limit of the calling thread, a thread calling it every
+ * second spares log_msg from reading the clock */
+void log_refill(void);
+
+/* queue one line of @level, without any system call or lock */
+void log_msg(int level, const char *fmt, ...) __attribute__((format(printf,2,3)));
+
+/* the level is checked before the arguments are even formatted */
+#define   log_error(...)   do { if (log_level >= LOG_ERROR) log_msg(LOG_ERROR,__VA_ARGS__); } while(0)
+#define   log_warn(...)    do { if (log_level >= LOG_WARN) log_msg(LOG_WARN,__VA_ARGS__); } while(0)
+#define   log_info(...)    do { if (log_level >= LOG_INFO) log_msg(LOG_INFO,__VA_ARGS__); } while(0)
+#define   log_debug(...)   do { if (log_level >= LOG_DEBUG) log_msg(LOG_DEBUG,__VA_ARGS__); } while(0)
+
+#endif  /*LOG_UTIL_H*/
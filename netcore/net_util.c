@@ -0,0 +1,242 @@
+#include  "net_util.h"
+#include  "tool.h"
+#include  "log_util.h"
+
+#include  <string.h>
+#include  <time.h>
+#include  <fcntl.h>
+#include  <unistd.h>
+#include  <arpa/inet.h>
+#include  <sys/epoll.h>
+#include  <sys/resource.h>
+
+/* now_ns: the monotonic clock in ns
+ *
+ * */
+long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* sock_bind: create and bind a new socket with @port
+ * @port: the port used to bind the socket
+ * @reuseport: whether several listen sockets share the port, the kernel
+ * balances the new connections among them
+ *
+ * */
+int bind_sock(int port, int reuseport)
+{
+    int listenfd;
+    struct sockaddr_in socket_addr;
+
+    /* create a new socket */
+    if ((listenfd = socket(AF_INET,SOCK_STREAM,0)) < 0)
+    {
+        perror_exit("socket error");
+    }
+
+    /* a restarted server binds again while the old connections linger in
+     * TIME_WAIT */
+    int on = 1;
+    if (setsockopt(listenfd,SOL_SOCKET,SO_REUSEADDR,&on,sizeof(on)) < 0)
+    {
+        perror_exit("setsockopt error");
+    }
+    if (reuseport && setsockopt(listenfd,SOL_SOCKET,SO_REUSEPORT,&on,sizeof(on)) < 0)
+    {
+        perror_exit("setsockopt error");
+    }
+
+    /* fill the socket address struct */
+    memset(&socket_addr,0,sizeof(struct sockaddr_in));
+    socket_addr.sin_family = AF_INET;
+    socket_addr.sin_port = htons(port);
+    socket_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    /* bind the socket */
+    if (bind(listenfd,(struct sockaddr *)&socket_addr,sizeof(struct sockaddr_in)) < 0)
+    {
+        perror_exit("bind error");
+    }
+
+    return listenfd;
+}
+
+/* default_backlog: the backlog the kernel allows, a larger one passed to
+ * listen is cut down to it anyway
+ *
+ * return /proc/sys/net/core/somaxconn, LISTENQ if it cannot be read
+ *
+ * */
+int default_backlog(void)
+{
+    int backlog = LISTENQ;
+    FILE *fp;
+
+    if ( (fp = fopen("/proc/sys/net/core/somaxconn","r")) != NULL )
+    {
+        if (fscanf(fp,"%d",&backlog) != 1 || backlog <= 0)
+        {
+            backlog = LISTENQ;
+        }
+        fclose(fp);
+    }
+
+    return backlog;
+}
+
+/* sock_listen: listen the @listenfd socket
+ * @listenfd: the socket used for listening
+ * @backlog: the completed connections queued until they are accepted
+ *
+ * */
+void listen_sock(int listenfd, int backlog)
+{
+    if (listen(listenfd,backlog) < 0)
+    {
+        perror_exit("listen error");
+    }
+}
+
+/* raise_nofile: raise the soft limit of open files to the hard limit, so
+ * the server is bounded by the system instead of the default 1024
+ *
+ * */
+void raise_nofile(void)
+{
+    struct rlimit rl;
+
+    if (getrlimit(RLIMIT_NOFILE,&rl) == 0 && rl.rlim_cur < rl.rlim_max)
+    {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE,&rl);
+    }
+}
+
+/* setnonblock: set the non-blocking @fd
+ * @fd: the fd to be set
+ *
+ * */
+void setnonblock(int fd)
+{
+    int opt;
+    /* get the orignal option */
+    if ( (opt = fcntl(fd,F_GETFL)) < 0 )
+    {
+        perror_exit("fctl error");
+    }
+
+    /* set non-block option */
+    opt |= O_NONBLOCK;
+    if ( fcntl(fd,F_SETFL, opt) < 0 )
+    {
+        perror_exit("fcntl error");
+    }
+}
+
+/* show_client_info: show the client information including ip address and port
+ * @connfd: the connected fd used to show the information
+ *
+ * */
+void show_peer_info(int connfd)
+{
+    struct sockaddr_in clitaddr;
+    socklen_t socklen = sizeof(struct sockaddr_in);
+
+    if ((getpeername(connfd,(struct sockaddr *)&clitaddr,&socklen)) < 0)
+    {
+        perror_exit("getpeername error");
+    }
+
+    show_addr_info(&clitaddr);
+}
+
+/* show_addr_info: show the ip address and port of @addr
+ * @addr: the address to be shown
+ *
+ * */
+void show_addr_info(const struct sockaddr_in *addr)
+{
+    char ipaddr[INET_ADDRSTRLEN];
+
+    if (inet_ntop(AF_INET,&addr->sin_addr,ipaddr,sizeof(ipaddr)) == NULL)
+    {
+        perror_exit("inet_ntop error");
+    }
+
+    int port = ntohs(addr->sin_port);
+    printf("peer information: %s:%d\n", ipaddr, port);
+}
+
+/* log_addr_info: log the ip address and port of @addr at the info level,
+ * the servers pass the address accept returned, and the line is written by
+ * the flusher so an accept costs no write
+ * @addr: the address to be logged
+ *
+ * */
+void log_addr_info(const struct sockaddr_in *addr)
+{
+    char ipaddr[INET_ADDRSTRLEN];
+
+    /* a line that cannot be formatted is not worth the server */
+    if (inet_ntop(AF_INET,&addr->sin_addr,ipaddr,sizeof(ipaddr)) == NULL)
+    {
+        return;
+    }
+
+    log_info("peer information: %s:%d", ipaddr, ntohs(addr->sin_port));
+}
+
+/* add_epoll_event: add an @fd into @epollfd set
+ * @epollfd: the epoll set the fd added into
+ * @fd: the fd to be added into the epoll set
+ * @state: the related event of the fd to be add
+ *
+ * */
+void add_epoll_event(int epollfd, int fd, int state)
+{
+    struct epoll_event ev;
+    ev.events = state;
+    ev.data.fd = fd;
+    if (epoll_ctl(epollfd,EPOLL_CTL_ADD,fd,&ev) < 0 )
+    {
+        perror_exit("epoll control error");
+    }
+}
+
+/* modify_epoll_event: modify an @fd in the @epollfd set
+ * @epollfd: the epoll set the fd belongs to
+ * @fd: the fd to be modified in the epoll set
+ * @state: the related event of fd the to be modified
+ *
+ * */
+void modify_epoll_event(int epollfd, int fd, int state)
+{
+    struct epoll_event ev;
+    ev.events = state;
+    ev.data.fd = fd;
+    if (epoll_ctl(epollfd,EPOLL_CTL_MOD,fd,&ev) < 0 )
+    {
+        perror_exit("epoll control error");
+    }
+}
+
+/* delete_epoll_event: delete an @fd from @epollfd set
+ * @epollfd: the epoll set the fd to be deleted from
+ * @fd: the fd to be deleted in the epoll set
+ * @state: the related event of the fd to be deleted
+ *
+ * */
+void delete_epoll_event(int epollfd, int fd, int state)
+{
+    struct epoll_event ev;
+    ev.events = state;
+    ev.data.fd = fd;
+    if (epoll_ctl(epollfd,EPOLL_CTL_DEL,fd,&ev) < 0 )
+    {
+        perror_exit("epoll control error");
+    }
+}
+
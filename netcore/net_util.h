@@ -0,0 +1,47 @@
+#ifndef  NET_UTIL_H
+#define  NET_UTIL_H
+
+#include  <sys/socket.h>
+#include  <netinet/in.h>
+
+/* the socket helpers every server shares, the servers only keep the code
+ * that makes their model different */
+
+/* the monotonic clock in ns */
+long long now_ns(void);
+
+/* create and bind the socket, shared with the other sockets bound to the
+ * same port if @reuseport */
+int bind_sock(int port, int reuseport);
+
+/* the listen backlog the kernel allows */
+int default_backlog(void);
+
+/* listen the socket */
+void listen_sock(int listenfd, int backlog);
+
+/* raise the limit of open files as far as allowed */
+void raise_nofile(void);
+
+/* set the non-blocking fd */
+void setnonblock(int fd);
+
+/* show the client information: ip address and port */
+void show_peer_info(int connfd);
+
+/* show the ip address and port of an address */
+void show_addr_info(const struct sockaddr_in *addr);
+
+/* log the ip address and port of an address through the logger */
+void log_addr_info(const struct sockaddr_in *addr);
+
+/* add an fd into epoll set */
+void add_epoll_event(int epollfd, int fd, int state);
+
+/* modify an fd in epoll set */
+void modify_epoll_event(int epollfd, int fd, int state);
+
+/* delete an fd in epoll set */
+void delete_epoll_event(int epollfd, int fd, int state);
+
+#endif  /*NET_UTIL_H*/
@@ -0,0 +1,107 @@
+#include  "prefork_util.h"
+#include  "sig_util.h"
+#include  "net_util.h"
+#include  "log_util.h"
+#include  "tool.h"
+
+#include  <unistd.h>
+#include  <arpa/inet.h>
+
+/* prefork_child: the body of a preforked child, it blocks in accept on the
+ * inherited listen socket and hands every client to @serve, the kernel
+ * wakes a single child per new connection
+ * @listenfd: the socket used to accept connections
+ * @serve: the handler of each client
+ *
+ * */
+static void prefork_child(int listenfd, prefork_serve_t serve)
+{
+    int connfd;
+    struct sockaddr_in clitaddr;
+    socklen_t socklen;
+
+    /* the flusher of the master does not survive the fork */
+    log_init(STDOUT_FILENO,log_level);
+
+    while( 1 )
+    {
+        socklen = sizeof(struct sockaddr_in);
+        if ((connfd = accept(listenfd,(struct sockaddr *)&clitaddr,&socklen)) < 0)
+        {
+            /* if accept is interrupted by signal, just continue. else print
+             * error and exit */
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            else
+            {
+                perror_exit("accept error");
+            }
+        }
+        /* show the new connected client information */
+        log_addr_info(&clitaddr);
+
+        serve(connfd);
+    }
+}
+
+/* spawn_child: fork a child running prefork_child
+ * @listenfd: the socket used to accept connections
+ * @serve: the handler of each client
+ * @mask: the signal mask the child runs with
+ *
+ * */
+static void spawn_child(int listenfd, prefork_serve_t serve, const sigset_t *mask)
+{
+    pid_t pid;
+    /* fork error */
+    if ((pid = fork()) < 0)
+    {
+        perror_exit("fork error");
+    }
+    else if (pid == 0)
+    {
+        sigprocmask(SIG_SETMASK,mask,NULL);
+        prefork_child(listenfd,serve);
+        exit(0);
+    }
+}
+
+/* prefork_run: fork @nchildren children up front which all accept on the
+ * shared listen socket, so a new client only pays for the accept. the
+ * master just keeps the pool full: chld_handler, which the caller installs
+ * for SIGCHLD, reaps the dead children and the master forks a replacement
+ * for each of them
+ * @listenfd: the socket used to accept connections
+ * @nchildren: the number of children
+ * @serve: the handler each child runs on its clients
+ *
+ * */
+void prefork_run(int listenfd, int nchildren, prefork_serve_t serve)
+{
+    int i;
+    sigset_t chldmask, oldmask;
+
+    /* SIGCHLD is only delivered inside sigsuspend, so no death is missed
+     * between checking the counter and going to sleep */
+    sigemptyset(&chldmask);
+    sigaddset(&chldmask,SIGCHLD);
+    sigprocmask(SIG_BLOCK,&chldmask,&oldmask);
+
+    for (i = 0; i < nchildren; ++i)
+    {
+        spawn_child(listenfd,serve,&oldmask);
+    }
+
+    while( 1 )
+    {
+        while (chld_reaped > 0)
+        {
+            chld_reaped--;
+            spawn_child(listenfd,serve,&oldmask);
+        }
+
+        sigsuspend(&oldmask);
+    }
+}
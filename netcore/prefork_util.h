@@ -0,0 +1,12 @@
+#ifndef  PREFORK_UTIL_H
+#define  PREFORK_UTIL_H
+
+/* prefork_serve: what a preforked child does with each client it accepts,
+ * it owns @connfd and may exit the child when it is done */
+typedef void (*prefork_serve_t)(int connfd);
+
+/* fork @nchildren children accepting on @listenfd and running @serve on
+ * each client, and keep the pool full for ever */
+void prefork_run(int listenfd, int nchildren, prefork_serve_t serve);
+
+#endif  /*PREFORK_UTIL_H*/
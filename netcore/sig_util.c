@@ -1,12 +1,18 @@
 #include  "sig_util.h"
 
+volatile sig_atomic_t chld_reaped = 0;
+
 /* SIGCHLD handler */
 void chld_handler(int signo)
 {
     pid_t chldpid;
     int stat;
+
+    (void)signo;
+
     while( (chldpid = waitpid(-1,&stat,WNOHANG)) > 0 )
     {
         printf("child %d terminated\n",chldpid);
+        chld_reaped++;
     }
 }
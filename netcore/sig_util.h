@@ -6,6 +6,10 @@
 #include  <signal.h>
 #include  <sys/wait.h>
 
+/* the number of children reaped by the SIGCHLD handler, the prefork master
+ * respawns that many */
+extern volatile sig_atomic_t chld_reaped;
+
 /* SIGCHLD handler */
 void chld_handler(int signo);
 
@@ -0,0 +1,16 @@
+#ifndef  NETCORE_TOOL_H
+#define  NETCORE_TOOL_H
+
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <errno.h>
+
+#define   perror_exit(strinfo)    do { perror(strinfo); \
+                                       exit(EXIT_FAILURE); \
+                                  } while(0);
+
+/* the listen backlog when somaxconn cannot be read */
+#define   LISTENQ      SOMAXCONN
+#define   INFTIM       -1
+
+#endif  /*NETCORE_TOOL_H*/
@@ -0,0 +1,321 @@
+#include  "uring_util.h"
+#include  "tool.h"
+
+/* uring_init: set up the ring and map the shared queues
+ * @ring: the ring to be initialized
+ * @entries: the number of submission entries
+ *
+ * */
+void uring_init(uring_t *ring, unsigned entries)
+{
+    struct io_uring_params params;
+    memset(&params,0,sizeof(params));
+    memset(ring,0,sizeof(uring_t));
+
+    /* multishot recv keeps many completions per submission in flight */
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = entries * 4;
+
+    if ( (ring->fd = syscall(__NR_io_uring_setup,entries,&params)) < 0 )
+    {
+        perror_exit("io_uring setup error");
+    }
+
+    size_t sqsize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cqsize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+    /* the submission and completion rings share one mapping on all the
+     * kernels that have the features used here */
+    if ( !(params.features & IORING_FEAT_SINGLE_MMAP) )
+    {
+        fprintf(stderr,"io_uring: kernel is too old\n");
+        exit(EXIT_FAILURE);
+    }
+    if (cqsize > sqsize)
+    {
+        sqsize = cqsize;
+    }
+
+    char *rings = mmap(NULL,sqsize,PROT_READ | PROT_WRITE,MAP_SHARED | MAP_POPULATE,ring->fd,IORING_OFF_SQ_RING);
+    if (rings == MAP_FAILED)
+    {
+        perror_exit("mmap error");
+    }
+
+    ring->sq_head = (unsigned *)(rings + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(rings + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(rings + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(rings + params.sq_off.array);
+    ring->sq_entries = params.sq_entries;
+
+    ring->cq_head = (unsigned *)(rings + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(rings + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(rings + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(rings + params.cq_off.cqes);
+
+    ring->sqes = mmap(NULL,params.sq_entries * sizeof(struct io_uring_sqe),PROT_READ | PROT_WRITE,MAP_SHARED | MAP_POPULATE,ring->fd,IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+    {
+        perror_exit("mmap error");
+    }
+
+    /* the slot i of the submission ring always points at entry i */
+    unsigned i;
+    for (i = 0; i < params.sq_entries; ++i)
+    {
+        ring->sq_array[i] = i;
+    }
+    ring->sqe_tail = *ring->sq_tail;
+}
+
+/* uring_get_sqe: get the next submission entry
+ * @ring: the ring
+ *
+ * */
+struct io_uring_sqe *uring_get_sqe(uring_t *ring)
+{
+    unsigned head = __atomic_load_n(ring->sq_head,__ATOMIC_ACQUIRE);
+
+    /* the submission ring is full, hand the queued entries to the kernel */
+    if (ring->sqe_tail - head >= ring->sq_entries)
+    {
+        uring_submit_and_wait(ring,0);
+        head = __atomic_load_n(ring->sq_head,__ATOMIC_ACQUIRE);
+    }
+
+    struct io_uring_sqe *sqe = &ring->sqes[ring->sqe_tail & *ring->sq_mask];
+    ring->sqe_tail++;
+    memset(sqe,0,sizeof(struct io_uring_sqe));
+    return sqe;
+}
+
+/* uring_submit_and_wait: submit the queued entries and wait for completions
+ * in one syscall
+ * @ring: the ring
+ * @wait_nr: the number of completions to wait for
+ *
+ * */
+int uring_submit_and_wait(uring_t *ring, unsigned wait_nr)
+{
+    unsigned tosubmit = ring->sqe_tail - *ring->sq_tail;
+    __atomic_store_n(ring->sq_tail,ring->sqe_tail,__ATOMIC_RELEASE);
+
+    if (tosubmit == 0 && wait_nr == 0)
+    {
+        return 0;
+    }
+
+    int ret;
+    while ( (ret = syscall(__NR_io_uring_enter,ring->fd,tosubmit,wait_nr,wait_nr ? IORING_ENTER_GETEVENTS : 0,NULL,0)) < 0 )
+    {
+        if (errno != EINTR)
+        {
+            perror_exit("io_uring enter error");
+        }
+    }
+    return ret;
+}
+
+/* uring_peek_cqe: the next completion
+ * @ring: the ring
+ *
+ * */
+struct io_uring_cqe *uring_peek_cqe(uring_t *ring)
+{
+    unsigned head = *ring->cq_head;
+    if (head == __atomic_load_n(ring->cq_tail,__ATOMIC_ACQUIRE))
+    {
+        return NULL;
+    }
+    return &ring->cqes[head & *ring->cq_mask];
+}
+
+/* uring_cqe_seen: consume the completion returned by uring_peek_cqe
+ * @ring: the ring
+ *
+ * */
+void uring_cqe_seen(uring_t *ring)
+{
+    __atomic_store_n(ring->cq_head,*ring->cq_head + 1,__ATOMIC_RELEASE);
+}
+
+/* uring_bufring_init: register a ring of provided buffers
+ * @ring: the ring the buffers are registered with
+ * @br: the buffer ring to be initialized
+ * @entries: the number of buffers, a power of two
+ * @bufsize: the size of each buffer
+ * @bgid: the buffer group id
+ *
+ * */
+void uring_bufring_init(uring_t *ring, uring_bufring_t *br, unsigned entries, unsigned bufsize, int bgid)
+{
+    void *mem;
+    if ( (errno = posix_memalign(&mem,sysconf(_SC_PAGESIZE),entries * sizeof(struct io_uring_buf))) != 0 )
+    {
+        perror_exit("posix_memalign error");
+    }
+    memset(mem,0,entries * sizeof(struct io_uring_buf));
+
+    br->ring = mem;
+    br->entries = entries;
+    br->bufsize = bufsize;
+    br->bgid = bgid;
+    br->tail = 0;
+    if ( (br->base = malloc((size_t)entries * bufsize)) == NULL )
+    {
+        perror_exit("malloc error");
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg,0,sizeof(reg));
+    reg.ring_addr = (unsigned long)br->ring;
+    reg.ring_entries = entries;
+    reg.bgid = bgid;
+    if (syscall(__NR_io_uring_register,ring->fd,IORING_REGISTER_PBUF_RING,&reg,1) < 0)
+    {
+        perror_exit("io_uring register error");
+    }
+
+    unsigned i;
+    for (i = 0; i < entries; ++i)
+    {
+        uring_bufring_add(br,i);
+    }
+    uring_bufring_commit(br);
+}
+
+/* uring_bufring_buf: the address of buffer @bid
+ * @br: the buffer ring
+ * @bid: the buffer id
+ *
+ * */
+char *uring_bufring_buf(const uring_bufring_t *br, int bid)
+{
+    return br->base + (size_t)bid * br->bufsize;
+}
+
+/* uring_bufring_add: queue buffer @bid to be given back to the kernel
+ * @br: the buffer ring
+ * @bid: the buffer id
+ *
+ * */
+void uring_bufring_add(uring_bufring_t *br, int bid)
+{
+    struct io_uring_buf *buf = &br->ring->bufs[br->tail & (br->entries - 1)];
+    buf->addr = (unsigned long)uring_bufring_buf(br,bid);
+    buf->len = br->bufsize;
+    buf->bid = bid;
+    br->tail++;
+}
+
+/* uring_bufring_commit: publish the queued buffers to the kernel
+ * @br: the buffer ring
+ *
+ * */
+void uring_bufring_commit(uring_bufring_t *br)
+{
+    __atomic_store_n(&br->ring->tail,br->tail,__ATOMIC_RELEASE);
+}
+
+/* uring_prep_accept: accept one new connection and the address of the
+ * client, the kernel writes it before the completion is posted
+ * @sqe: the submission entry
+ * @fd: the listening socket
+ * @addr: the address of the client, it must stay valid until the completion
+ * @addrlen: the size of @addr, set to the length of the address
+ *
+ * */
+void uring_prep_accept(struct io_uring_sqe *sqe, int fd, struct sockaddr *addr, socklen_t *addrlen)
+{
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = fd;
+    sqe->addr = (unsigned long)addr;
+    sqe->addr2 = (unsigned long)addrlen;
+    sqe->accept_flags = SOCK_CLOEXEC;
+}
+
+/* uring_prep_recv_multishot: one request receiving every chunk of data, the
+ * kernel picks a buffer of group @bgid for each chunk
+ * @sqe: the submission entry
+ * @fd: the connected socket
+ * @bgid: the buffer group id
+ *
+ * */
+void uring_prep_recv_multishot(struct io_uring_sqe *sqe, int fd, int bgid)
+{
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = bgid;
+}
+
+/* uring_prep_send: send @len bytes from @buf
+ * @sqe: the submission entry
+ * @fd: the connected socket
+ * @buf: the data
+ * @len: the length of data
+ * @flags: the send flags
+ *
+ * */
+void uring_prep_send(struct io_uring_sqe *sqe, int fd, const void *buf, unsigned len, int flags)
+{
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = fd;
+    sqe->addr = (unsigned long)buf;
+    sqe->len = len;
+    sqe->msg_flags = flags;
+}
+
+/* uring_prep_poll_add: one request completing once @fd is ready for any of
+ * @mask, like a one-shot poll
+ * @sqe: the submission entry
+ * @fd: the fd to be polled
+ * @mask: the poll events, POLLIN, POLLOUT...
+ *
+ * */
+void uring_prep_poll_add(struct io_uring_sqe *sqe, int fd, unsigned mask)
+{
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = mask;
+}
+
+/* uring_prep_poll_remove: cancel the poll request submitted as @user_data
+ * @sqe: the submission entry
+ * @user_data: the user data of the poll request
+ *
+ * */
+void uring_prep_poll_remove(struct io_uring_sqe *sqe, unsigned long long user_data)
+{
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = user_data;
+}
+
+/* uring_prep_cancel: cancel the request submitted as @user_data, the
+ * request still posts its last completion, with -ECANCELED
+ * @sqe: the submission entry
+ * @user_data: the user data of the request
+ *
+ * */
+void uring_prep_cancel(struct io_uring_sqe *sqe, unsigned long long user_data)
+{
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = user_data;
+}
+
+/* uring_prep_timeout: one request completing with -ETIME after @ts, unless
+ * it is cancelled first
+ * @sqe: the submission entry
+ * @ts: the relative timeout, it must stay valid until the completion
+ *
+ * */
+void uring_prep_timeout(struct io_uring_sqe *sqe, struct __kernel_timespec *ts)
+{
+    sqe->opcode = IORING_OP_TIMEOUT;
+    sqe->fd = -1;
+    sqe->addr = (unsigned long)ts;
+    sqe->len = 1;
+}
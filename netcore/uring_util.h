@@ -0,0 +1,105 @@
+#ifndef  URING_UTIL_H
+#define  URING_UTIL_H
+
+#include  <stdlib.h>
+#include  <string.h>
+#include  <unistd.h>
+#include  <sys/mman.h>
+#include  <sys/socket.h>
+#include  <sys/syscall.h>
+#include  <linux/io_uring.h>
+
+/* uring: a minimal io_uring instance driven by the raw syscalls
+ * .fd: the ring fd
+ * .sq_head/.sq_tail/.sq_mask/.sq_array: the shared submission ring
+ * .sqes: the submission queue entries
+ * .sqe_tail: the next entry handed out, ahead of *sq_tail until submitted
+ * .cq_head/.cq_tail/.cq_mask/.cqes: the shared completion ring
+ *
+ * */
+typedef struct uring
+{
+    int fd;
+
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned sq_entries;
+    struct io_uring_sqe *sqes;
+    unsigned sqe_tail;
+
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+}uring_t;
+
+/* uring_bufring: a ring of provided buffers the kernel picks from
+ * .ring: the shared buffer ring
+ * .base: the memory of all buffers, buffer i starts at base + i*bufsize
+ * .entries: the number of buffers, a power of two
+ * .bufsize: the size of each buffer
+ * .bgid: the buffer group id used by the requests
+ * .tail: the local tail, published to the kernel by uring_bufring_commit
+ *
+ * */
+typedef struct uring_bufring
+{
+    struct io_uring_buf_ring *ring;
+    char *base;
+    unsigned entries;
+    unsigned bufsize;
+    int bgid;
+    unsigned short tail;
+}uring_bufring_t;
+
+/* set up the ring with @entries submission entries */
+void uring_init(uring_t *ring, unsigned entries);
+
+/* get a zeroed submission entry, submitting the queued ones if full */
+struct io_uring_sqe *uring_get_sqe(uring_t *ring);
+
+/* submit the queued entries and wait for @wait_nr completions */
+int uring_submit_and_wait(uring_t *ring, unsigned wait_nr);
+
+/* the next completion, NULL if there is none */
+struct io_uring_cqe *uring_peek_cqe(uring_t *ring);
+
+/* mark the completion returned by uring_peek_cqe as consumed */
+void uring_cqe_seen(uring_t *ring);
+
+/* register @entries provided buffers of @bufsize bytes as group @bgid */
+void uring_bufring_init(uring_t *ring, uring_bufring_t *br, unsigned entries, unsigned bufsize, int bgid);
+
+/* the address of buffer @bid */
+char *uring_bufring_buf(const uring_bufring_t *br, int bid);
+
+/* give buffer @bid back to the kernel, visible after commit */
+void uring_bufring_add(uring_bufring_t *br, int bid);
+
+/* publish the buffers added since the last commit */
+void uring_bufring_commit(uring_bufring_t *br);
+
+/* prepare an accept on @fd returning the client address in @addr */
+void uring_prep_accept(struct io_uring_sqe *sqe, int fd, struct sockaddr *addr, socklen_t *addrlen);
+
+/* prepare a multishot recv on @fd into buffers of group @bgid */
+void uring_prep_recv_multishot(struct io_uring_sqe *sqe, int fd, int bgid);
+
+/* prepare a send of @len bytes from @buf on @fd */
+void uring_prep_send(struct io_uring_sqe *sqe, int fd, const void *buf, unsigned len, int flags);
+
+/* prepare a one-shot poll of @fd for @mask */
+void uring_prep_poll_add(struct io_uring_sqe *sqe, int fd, unsigned mask);
+
+/* prepare the removal of the poll request submitted as @user_data */
+void uring_prep_poll_remove(struct io_uring_sqe *sqe, unsigned long long user_data);
+
+/* prepare the cancellation of the request submitted as @user_data */
+void uring_prep_cancel(struct io_uring_sqe *sqe, unsigned long long user_data);
+
+/* prepare a timeout completing after @ts */
+void uring_prep_timeout(struct io_uring_sqe *sqe, struct __kernel_timespec *ts);
+
+#endif  /*URING_UTIL_H*/
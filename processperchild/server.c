@@ -15,16 +15,49 @@
  *        info from peer. until peer side typed "ctrl+d" as well, the
  *        connection is close
  *
+ *        4. by default a process is forked per client. -f <#children> keeps
+ *        that many preforked processes waiting in accept instead.
+ *        example: ./server -f 4 9899
+ *
+ *        5. -b <#backlog> sets the listen backlog, the completed
+ *        connections the kernel queues until they are accepted (default:
+ *        /proc/sys/net/core/somaxconn, which also caps it).
+ *        example: ./server -b 1024 9899
+ *
  *        */
 
+static void usage(void)
+{
+    printf("usage: ./server [-f #children] [-b #backlog] <#port>\n");
+    exit(EXIT_FAILURE);
+}
+
 int main(int argc, char *argv[])
 {
-    if (argc != 2)
+    int nchildren = 0;
+    int backlog = default_backlog();
+    int opt;
+
+    while ( (opt = getopt(argc,argv,"f:b:")) != -1 )
+    {
+        switch (opt)
+        {
+            case 'f':
+                nchildren = atoi(optarg);
+                break;
+            case 'b':
+                backlog = atoi(optarg);
+                break;
+            default:
+                usage();
+        }
+    }
+
+    if (optind != argc - 1 || nchildren < 0 || backlog <= 0)
     {
-        printf("usage: ./server <#port>\n");
-        exit(EXIT_FAILURE);
+        usage();
     }
-    int port = atoi(argv[1]);
+    int port = atoi(argv[optind]);
 
     /* SIGCHLD handler */
     struct sigaction sigchld;
@@ -33,11 +66,20 @@ int main(int argc, char *argv[])
     sigchld.sa_flags = 0;
     sigaction(SIGCHLD,&sigchld,NULL);
 
-    int listenfd = bind_sock(port);
+    log_init(STDOUT_FILENO,LOG_INFO);
 
-    listen_sock(listenfd);
+    int listenfd = bind_sock(port,0);
 
-    handle_connection(listenfd);
+    listen_sock(listenfd,backlog);
+
+    if (nchildren > 0)
+    {
+        prefork_run(listenfd,nchildren,chat_once);
+    }
+    else
+    {
+        handle_connection(listenfd);
+    }
 
     return 0;
 }
@@ -1,46 +1,5 @@
 #include  "sock_util.h"
-
-/* sock_bind: create and bind a new socket with @port
- * @port:   the port used to bind the socket
- *
- * */
-int bind_sock(int port)
-{
-    int listenfd;
-    struct sockaddr_in socket_addr;
-
-    /* create a new socket */
-    if ((listenfd = socket(AF_INET,SOCK_STREAM,0)) < 0)
-    {
-        perror_exit("socket error");
-    }
-
-    /* fill the socket address struct */
-    memset(&socket_addr,0,sizeof(struct sockaddr_in));
-    socket_addr.sin_family = AF_INET;
-    socket_addr.sin_port = htons(port);
-    socket_addr.sin_addr.s_addr = htonl(INADDR_ANY);
-
-    /* bind the socket */
-    if (bind(listenfd,(struct sockaddr *)&socket_addr,sizeof(struct sockaddr_in)) < 0)
-    {
-        perror_exit("bind error");
-    }
-
-    return listenfd;
-}
-
-/* sock_listen: listen the @listenfd socket
- * @listenfd: the socket used for listen
- *
- * */
-void listen_sock(int listenfd)
-{
-    if (listen(listenfd,LISTENQ) < 0)
-    {
-        perror_exit("listen error");
-    }
-}
+#include  "sig_util.h"
 
 /* handle_connection: handle the connected clients
  * @listenfd: the socket used to accept connections
@@ -53,6 +12,7 @@ void handle_connection(int listenfd)
     socklen_t socklen;
     while( 1 )
     {
+        socklen = sizeof(struct sockaddr_in);
         if ((connfd = accept(listenfd,(struct sockaddr *)&clitaddr,&socklen)) < 0)
         {
             /* if accept is interrupted by signal, just continue. else print
@@ -67,7 +27,7 @@ void handle_connection(int listenfd)
             }
         }
         /* show the new connected client information */
-        show_peer_info(connfd);
+        log_addr_info(&clitaddr);
 
         pid_t pid;
         /* fork error */
@@ -94,29 +54,16 @@ void handle_connection(int listenfd)
     }
 }
 
-/* show_client_info: show the client information including ip address and port
- * @connfd: the connected fd used to show the information
+/* chat_once: the body of a preforked child for one client, the
+ * communication takes over the standard input so the child exits
+ * afterwards and the master forks a fresh one
+ * @connfd: the connected socket used for communication
  *
  * */
-void show_peer_info(int connfd)
+void chat_once(int connfd)
 {
-    struct sockaddr_in clitaddr;
-    socklen_t socklen;
-
-    if ((getpeername(connfd,(struct sockaddr *)&clitaddr,&socklen)) < 0)
-    {
-        perror_exit("getpeername error");
-    }
-
-    char ipaddr[20];
-
-    if (inet_ntop(AF_INET,&clitaddr.sin_addr,ipaddr,socklen) < 0)
-    {
-        perror_exit("inet_ntop error");
-    }
-
-    int port = ntohs(clitaddr.sin_port);
-    printf("peer information: %s:%d\n", ipaddr, port);
+    do_communication(connfd);
+    exit(0);
 }
 
 /* do_communication: server and client communicate with each other
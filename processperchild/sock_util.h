@@ -16,23 +16,19 @@
 #include  <arpa/inet.h>
 
 #include  "tool.h"
+#include  "net_util.h"
+#include  "log_util.h"
+#include  "prefork_util.h"
 
 #define   MAXLINE      1024
-#define   LISTENQ      5
-
-/* create and bind the socket */
-int bind_sock(int port);
-
-/* listen the socket */
-void listen_sock(int listenfd);
-
 /* handle the connected clients */
 void handle_connection(int listenfd);
         
-/* show the client information: ip address and port */
-void show_peer_info(int connfd);
 
 /* server and client communicate with each other */
 void do_communication(int connfd);
 
+/* talk to one client in a preforked child, then exit it */
+void chat_once(int connfd);
+
 #endif  /*SOCK_UTIL_H*/
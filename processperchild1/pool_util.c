@@ -0,0 +1,194 @@
+#include  "pool_util.h"
+
+/* mpmc_init: initialize an empty queue
+ * @queue: the queue to be initialized
+ * @size: the number of slots, a power of two
+ *
+ * */
+void mpmc_init(mpmc_queue_t *queue, unsigned long size)
+{
+    unsigned long i;
+
+    if ( (queue->cells = malloc(size * sizeof(mpmc_cell_t))) == NULL )
+    {
+        perror_exit("malloc error");
+    }
+    for (i = 0; i < size; ++i)
+    {
+        queue->cells[i].seq = i;
+    }
+    queue->mask = size - 1;
+    queue->enqueue = 0;
+    queue->dequeue = 0;
+}
+
+/* mpmc_push: push @fd into the queue, a slot is free for position pos when
+ * its seq equals pos, the producer claims the position with a cas and then
+ * publishes the value by moving seq to pos + 1
+ * @queue: the queue
+ * @fd: the value to be pushed
+ *
+ * */
+int mpmc_push(mpmc_queue_t *queue, int fd)
+{
+    mpmc_cell_t *cell;
+    unsigned long pos = __atomic_load_n(&queue->enqueue,__ATOMIC_RELAXED);
+
+    while( 1 )
+    {
+        cell = &queue->cells[pos & queue->mask];
+        unsigned long seq = __atomic_load_n(&cell->seq,__ATOMIC_ACQUIRE);
+        long diff = (long)seq - (long)pos;
+
+        if (diff == 0)
+        {
+            if (__atomic_compare_exchange_n(&queue->enqueue,&pos,pos + 1,1,__ATOMIC_RELAXED,__ATOMIC_RELAXED))
+            {
+                break;
+            }
+        }
+        /* the slot still holds the value of the previous lap: full */
+        else if (diff < 0)
+        {
+            return -1;
+        }
+        else
+        {
+            pos = __atomic_load_n(&queue->enqueue,__ATOMIC_RELAXED);
+        }
+    }
+
+    cell->fd = fd;
+    __atomic_store_n(&cell->seq,pos + 1,__ATOMIC_RELEASE);
+    return 0;
+}
+
+/* mpmc_pop: pop the oldest fd, a slot holds a value for position pos when
+ * its seq equals pos + 1, the consumer frees it for the next lap by moving
+ * seq to pos + size
+ * @queue: the queue
+ * @fd: where the value is stored
+ *
+ * */
+int mpmc_pop(mpmc_queue_t *queue, int *fd)
+{
+    mpmc_cell_t *cell;
+    unsigned long pos = __atomic_load_n(&queue->dequeue,__ATOMIC_RELAXED);
+
+    while( 1 )
+    {
+        cell = &queue->cells[pos & queue->mask];
+        unsigned long seq = __atomic_load_n(&cell->seq,__ATOMIC_ACQUIRE);
+        long diff = (long)seq - (long)(pos + 1);
+
+        if (diff == 0)
+        {
+            if (__atomic_compare_exchange_n(&queue->dequeue,&pos,pos + 1,1,__ATOMIC_RELAXED,__ATOMIC_RELAXED))
+            {
+                break;
+            }
+        }
+        /* nothing has been pushed into the slot yet: empty */
+        else if (diff < 0)
+        {
+            return -1;
+        }
+        else
+        {
+            pos = __atomic_load_n(&queue->dequeue,__ATOMIC_RELAXED);
+        }
+    }
+
+    *fd = cell->fd;
+    __atomic_store_n(&cell->seq,pos + queue->mask + 1,__ATOMIC_RELEASE);
+    return 0;
+}
+
+/* sem_wait_intr: wait on @sem, retrying when interrupted by a signal */
+static void sem_wait_intr(sem_t *sem)
+{
+    while (sem_wait(sem) < 0)
+    {
+        if (errno != EINTR)
+        {
+            perror_exit("sem_wait error");
+        }
+    }
+}
+
+/* worker_main: the body of a worker, serve the connections one after another
+ * @arg: the pool
+ *
+ * */
+static void *worker_main(void *arg)
+{
+    thread_pool_t *pool = arg;
+    int connfd;
+
+    while( 1 )
+    {
+        sem_wait_intr(&pool->items);
+        while (mpmc_pop(&pool->queue,&connfd) < 0)
+        {
+            /* a producer claimed the slot but has not published it yet */
+            sched_yield();
+        }
+        sem_post(&pool->slots);
+
+        pool->handler(connfd);
+    }
+
+    return NULL;
+}
+
+/* pool_start: start the workers
+ * @pool: the pool to be started
+ * @nworkers: the number of worker threads
+ * @qsize: the number of queue slots, a power of two
+ * @handler: the function serving one connection, it owns and closes the fd
+ *
+ * */
+void pool_start(thread_pool_t *pool, int nworkers, unsigned long qsize, void (*handler)(int))
+{
+    int i;
+
+    mpmc_init(&pool->queue,qsize);
+    if (sem_init(&pool->items,0,0) < 0 || sem_init(&pool->slots,0,qsize) < 0)
+    {
+        perror_exit("sem_init error");
+    }
+
+    pool->nworkers = nworkers;
+    pool->handler = handler;
+    if ( (pool->workers = calloc(nworkers,sizeof(pthread_t))) == NULL )
+    {
+        perror_exit("calloc error");
+    }
+
+    for (i = 0; i < nworkers; ++i)
+    {
+        if ( (errno = pthread_create(&pool->workers[i],NULL,worker_main,pool)) != 0 )
+        {
+            perror_exit("pthread create error");
+        }
+    }
+}
+
+/* pool_submit: hand @connfd to a worker
+ * @pool: the pool
+ * @connfd: the accepted connection
+ *
+ * */
+void pool_submit(thread_pool_t *pool, int connfd)
+{
+    /* the queue is full: hold off accepting, new clients wait in the
+     * listen backlog instead */
+    sem_wait_intr(&pool->slots);
+
+    /* a slot is free, a consumer may just not have released it yet */
+    while (mpmc_push(&pool->queue,connfd) < 0)
+    {
+        sched_yield();
+    }
+    sem_post(&pool->items);
+}
@@ -0,0 +1,74 @@
+#ifndef  POOL_UTIL_H
+#define  POOL_UTIL_H
+
+#include  <stdlib.h>
+#include  <pthread.h>
+#include  <semaphore.h>
+#include  <sched.h>
+
+#include  "tool.h"
+
+/* the cache line size, the queue positions live on their own lines */
+#define   CACHELINE    64
+
+/* mpmc_cell: one slot of the queue
+ * .seq: the turn of the slot, tells producers and consumers whether the
+ *  slot is free or holds a value for the current position
+ * .fd: the value
+ *
+ * */
+typedef struct mpmc_cell
+{
+    unsigned long seq;
+    int fd;
+}mpmc_cell_t;
+
+/* mpmc_queue: a bounded lock-free multi-producer multi-consumer queue of fds
+ * .cells: the slots, a power of two of them
+ * .mask: the number of slots minus one
+ * .enqueue: the next position to push into
+ * .dequeue: the next position to pop from
+ *
+ * */
+typedef struct mpmc_queue
+{
+    mpmc_cell_t *cells;
+    unsigned long mask;
+    unsigned long enqueue __attribute__((aligned(CACHELINE)));
+    unsigned long dequeue __attribute__((aligned(CACHELINE)));
+}mpmc_queue_t;
+
+/* thread_pool: a fixed set of pre-started workers fed through the queue
+ * .queue: the accepted connections waiting for a worker
+ * .items: counts the fds in the queue, workers sleep on it when it is empty
+ * .slots: counts the free slots, the acceptor sleeps on it when it is full
+ * .workers/.nworkers: the worker threads
+ * .handler: the function serving one connection
+ *
+ * */
+typedef struct thread_pool
+{
+    mpmc_queue_t queue;
+    sem_t items;
+    sem_t slots;
+    pthread_t *workers;
+    int nworkers;
+    void (*handler)(int connfd);
+}thread_pool_t;
+
+/* initialize the queue with @size slots, a power of two */
+void mpmc_init(mpmc_queue_t *queue, unsigned long size);
+
+/* push @fd, return -1 if the queue is full */
+int mpmc_push(mpmc_queue_t *queue, int fd);
+
+/* pop into @fd, return -1 if the queue is empty */
+int mpmc_pop(mpmc_queue_t *queue, int *fd);
+
+/* start @nworkers threads running @handler on the submitted fds */
+void pool_start(thread_pool_t *pool, int nworkers, unsigned long qsize, void (*handler)(int));
+
+/* hand @connfd to the pool, wait if every slot of the queue is taken */
+void pool_submit(thread_pool_t *pool, int connfd);
+
+#endif  /*POOL_UTIL_H*/
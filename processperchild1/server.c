@@ -13,16 +13,60 @@
  *        3. type the combo keys "ctrl+d" meaning "EOF" by client will cause
  *        the client and server to close the connection.
  *
+ *        4. by default a process is forked per client. -t <#threads> serves
+ *        the clients with that many pre-started worker threads instead, and
+ *        -f <#children> with that many preforked processes.
+ *        example: ./server -t 16 9899
+ *                 ./server -f 16 9899
+ *        a worker or a child serves one connection until the client
+ *        closes, so at most #threads (#children) clients are served at
+ *        once. the clients beyond that are accepted but wait, the pool in
+ *        its queue and prefork in the listen backlog, until a served
+ *        client leaves.
+ *
+ *        5. -b <#backlog> sets the listen backlog, the completed
+ *        connections the kernel queues until they are accepted (default:
+ *        /proc/sys/net/core/somaxconn, which also caps it).
+ *        example: ./server -b 1024 9899
+ *
  *        */
 
+static void usage(void)
+{
+    printf("usage: ./server [-t #threads | -f #children] [-b #backlog] <#port>\n");
+    printf("       -t and -f serve at most #threads or #children clients at once\n");
+    exit(EXIT_FAILURE);
+}
+
 int main(int argc, char *argv[])
 {
-    if (argc != 2)
+    int nthreads = 0, nchildren = 0;
+    int backlog = default_backlog();
+    int opt;
+
+    while ( (opt = getopt(argc,argv,"t:f:b:")) != -1 )
+    {
+        switch (opt)
+        {
+            case 't':
+                nthreads = atoi(optarg);
+                break;
+            case 'f':
+                nchildren = atoi(optarg);
+                break;
+            case 'b':
+                backlog = atoi(optarg);
+                break;
+            default:
+                usage();
+        }
+    }
+
+    if (optind != argc - 1 || nthreads < 0 || nchildren < 0 || (nthreads && nchildren) || backlog <= 0)
     {
-        printf("usage: ./server <#port>\n");
-        exit(EXIT_FAILURE);
+        usage();
     }
-    int port = atoi(argv[1]);
+    int port = atoi(argv[optind]);
 
     /* SIGCHLD handler */
     struct sigaction sigchld;
@@ -31,11 +75,27 @@ int main(int argc, char *argv[])
     sigchld.sa_flags = 0;
     sigaction(SIGCHLD,&sigchld,NULL);
 
-    int listenfd = bind_sock(port);
+    log_init(STDOUT_FILENO,LOG_INFO);
 
-    listen_sock(listenfd);
+    int listenfd = bind_sock(port,0);
 
-    handle_connection(listenfd);
+    listen_sock(listenfd,backlog);
+
+    if (nthreads > 0)
+    {
+        /* a client closing early must not kill the whole pool on write */
+        signal(SIGPIPE,SIG_IGN);
+
+        handle_connection_pool(listenfd,nthreads);
+    }
+    else if (nchildren > 0)
+    {
+        prefork_run(listenfd,nchildren,server_echo);
+    }
+    else
+    {
+        handle_connection(listenfd);
+    }
 
     return 0;
 }
@@ -1,46 +1,5 @@
 #include  "sock_util.h"
-
-/* sock_bind: create and bind a new socket with @port
- * @port:   the port used to bind the socket
- *
- * */
-int bind_sock(int port)
-{
-    int listenfd;
-    struct sockaddr_in socket_addr;
-
-    /* create a new socket */
-    if ((listenfd = socket(AF_INET,SOCK_STREAM,0)) < 0)
-    {
-        perror_exit("socket error");
-    }
-
-    /* fill the socket address struct */
-    memset(&socket_addr,0,sizeof(struct sockaddr_in));
-    socket_addr.sin_family = AF_INET;
-    socket_addr.sin_port = htons(port);
-    socket_addr.sin_addr.s_addr = htonl(INADDR_ANY);
-
-    /* bind the socket */
-    if (bind(listenfd,(struct sockaddr *)&socket_addr,sizeof(struct sockaddr_in)) < 0)
-    {
-        perror_exit("bind error");
-    }
-
-    return listenfd;
-}
-
-/* sock_listen: listen the @listenfd socket
- * @listenfd: the socket used for listen
- *
- * */
-void listen_sock(int listenfd)
-{
-    if (listen(listenfd,LISTENQ) < 0)
-    {
-        perror_exit("listen error");
-    }
-}
+#include  "sig_util.h"
 
 /* handle_connection: handle the connected clients
  * @listenfd: the socket used to accept connections
@@ -53,6 +12,7 @@ void handle_connection(int listenfd)
     socklen_t socklen;
     while( 1 )
     {
+        socklen = sizeof(struct sockaddr_in);
         if ((connfd = accept(listenfd,(struct sockaddr *)&clitaddr,&socklen)) < 0)
         {
             /* if accept is interrupted by signal, just continue. else print
@@ -67,7 +27,7 @@ void handle_connection(int listenfd)
             }
         }
         /* show the new connected client information */
-        show_peer_info(connfd);
+        log_addr_info(&clitaddr);
 
         pid_t pid;
         /* fork error */
@@ -94,32 +54,50 @@ void handle_connection(int listenfd)
     }
 }
 
-/* show_client_info: show the client information including ip address and port
- * @connfd: the connected fd used to show the information
+/* handle_connection_pool: handle the connected clients with a fixed pool of
+ * pre-started worker threads instead of forking a process per client, the
+ * accepted fds are handed over through a lock-free queue. a worker keeps its
+ * connection until the client closes, so only @nworkers clients are served
+ * at once and the others wait in the queue
+ * @listenfd: the socket used to accept connections
+ * @nworkers: the number of worker threads
  *
  * */
-void show_peer_info(int connfd)
+void handle_connection_pool(int listenfd, int nworkers)
 {
+    int connfd;
     struct sockaddr_in clitaddr;
     socklen_t socklen;
 
-    if ((getpeername(connfd,(struct sockaddr *)&clitaddr,&socklen)) < 0)
-    {
-        perror_exit("getpeername error");
-    }
-
-    char ipaddr[20];
+    thread_pool_t pool;
+    pool_start(&pool,nworkers,POOL_QUEUE,server_echo);
 
-    if (inet_ntop(AF_INET,&clitaddr.sin_addr,ipaddr,socklen) < 0)
+    while( 1 )
     {
-        perror_exit("inet_ntop error");
-    }
+        socklen = sizeof(struct sockaddr_in);
+        if ((connfd = accept(listenfd,(struct sockaddr *)&clitaddr,&socklen)) < 0)
+        {
+            /* if accept is interrupted by signal, just continue. else print
+             * error and exit */
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            else
+            {
+                perror_exit("accept error");
+            }
+        }
+        /* show the new connected client information */
+        log_addr_info(&clitaddr);
 
-    int port = ntohs(clitaddr.sin_port);
-    printf("peer information: %s:%d\n", ipaddr, port);
+        pool_submit(&pool,connfd);
+    }
 }
 
-/* server_echo: the server echoes the info received from client
+/* server_echo: the server echoes the info received from client, it returns
+ * once the connection is closed so that it can run in a forked child as well
+ * as in a pool worker
  * @connfd: the connected socket used for communication
  *
  * */
@@ -131,7 +109,7 @@ void server_echo(int connfd)
     while( (n = read(connfd,recvline,MAXLINE)) )
     {
         /* if n < 0 because the read is interrupted by signal, we just
-         * continue, else print error and exit */
+         * continue, else print error and drop the client */
         if ( n < 0 )
         {
             if (errno == EINTR)
@@ -140,24 +118,22 @@ void server_echo(int connfd)
             }
             else
             {
-                perror_exit("read error");
+                perror("read error");
+                break;
             }
         }
 
         /* n > 0, we echo the data to the client */
         if (write(connfd,recvline,n) < 0)
         {
-            perror_exit("write error");
+            perror("write error");
+            break;
         }
     }
 
     /* client type "ctrl+d" and send and "EOF", we server just close the
      * connection accordingly */
-    if (n == 0)
-    {
-        close(connfd);
-        exit(0);
-    }
+    close(connfd);
 }
 
 /* client handle the info received from both server and standard input
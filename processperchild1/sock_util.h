@@ -16,21 +16,18 @@
 #include  <arpa/inet.h>
 
 #include  "tool.h"
+#include  "net_util.h"
+#include  "log_util.h"
+#include  "prefork_util.h"
+#include  "pool_util.h"
 
 #define   MAXLINE      1024
-#define   LISTENQ      5
-
-/* create and bind the socket */
-int bind_sock(int port);
-
-/* listen the socket */
-void listen_sock(int listenfd);
-
 /* handle the connected clients */
 void handle_connection(int listenfd);
         
-/* show the client information: ip address and port */
-void show_peer_info(int connfd);
+/* handle the connected clients with a pool of worker threads */
+void handle_connection_pool(int listenfd, int nworkers);
+
 
 /* server echoes the info received from clients */
 void server_echo(int connfd);
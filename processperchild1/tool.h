@@ -8,4 +8,7 @@
                                        exit(EXIT_FAILURE); \
                                   } while(0);
 
+/* the number of accepted connections waiting for a pool worker */
+#define   POOL_QUEUE   1024
+
 #endif  /*TOOL_H*/